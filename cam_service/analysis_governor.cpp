@@ -0,0 +1,114 @@
+#include "analysis_governor.h"
+#include <atomic>
+#include <math.h>
+#include <new>
+#include <string.h>
+
+#define GOVERNOR_AVG_WEIGHT 0.1     // waga nowej próbki w średniej czasu analizy
+
+struct AnalysisGovernor {
+    GovernorParams params;
+    std::atomic<int> step;          // czytany przez wątek kamery
+    std::atomic<double> fps;        // params.fps lub tempo zmierzone (analysis_governor_set_fps)
+
+    // tylko wątek analizy
+    bool hadMotion;
+    long long lastMotionMs;
+    GovernorStats stats;
+};
+
+void* analysis_governor_init(GovernorParams params)
+{
+    if(params.fps <= 0 || params.activeStep < 1 || params.idleStep < params.activeStep)
+        return NULL;
+    if(params.holdMs < 0 || params.cpuBudget <= 0.0 || params.cpuBudget > 1.0)
+        return NULL;
+
+    AnalysisGovernor* g = new (std::nothrow) AnalysisGovernor();
+    if(!g)
+        return NULL;
+
+    g->params = params;
+    g->step.store(params.idleStep, std::memory_order_relaxed);
+    g->fps.store(params.fps, std::memory_order_relaxed);
+    g->hadMotion = false;
+    g->lastMotionMs = 0;
+    memset(&g->stats, 0, sizeof(g->stats));
+    g->stats.step = params.idleStep;
+
+    return g;
+}
+
+int analysis_governor_step(void* governor)
+{
+    if(!governor)
+        return 1;
+    return static_cast<AnalysisGovernor*>(governor)->step.load(std::memory_order_relaxed);
+}
+
+void analysis_governor_set_fps(void* governor, double fps)
+{
+    if(!governor || fps <= 0.0)
+        return;
+    static_cast<AnalysisGovernor*>(governor)->fps.store(fps, std::memory_order_relaxed);
+}
+
+int analysis_governor_update(void* governor, bool motion, double analysisMs, long long nowMs)
+{
+    if(!governor)
+        return 1;
+
+    AnalysisGovernor* g = static_cast<AnalysisGovernor*>(governor);
+    const GovernorParams& p = g->params;
+    GovernorStats& s = g->stats;
+
+    s.avgAnalysisMs = s.updates == 0 ? analysisMs :
+        s.avgAnalysisMs + (analysisMs - s.avgAnalysisMs) * GOVERNOR_AVG_WEIGHT;
+    s.updates++;
+
+    if(motion)
+    {
+        g->hadMotion = true;
+        g->lastMotionMs = nowMs;
+    }
+
+    // ruch lub niedawny ruch - od razu szybko; spokój - stopniowo wolniej
+    int desired;
+    if(g->hadMotion && nowMs - g->lastMotionMs <= p.holdMs)
+        desired = p.activeStep;
+    else
+        desired = s.step * 2 < p.idleStep ? s.step * 2 : p.idleStep;
+
+    // analiz na sekundę (fps / krok) * czas analizy <= budżet
+    const double fps = g->fps.load(std::memory_order_relaxed);
+    int budgetStep = (int)ceil(fps * s.avgAnalysisMs / (1000.0 * p.cpuBudget));
+    int step = desired;
+    if(budgetStep > step)
+    {
+        step = budgetStep;
+        s.budgetLimited++;
+    }
+    if(step < 1)
+        step = 1;
+
+    s.step = step;
+    s.cpuLoad = fps / step * s.avgAnalysisMs / 1000.0;
+    g->step.store(step, std::memory_order_relaxed);
+    return step;
+}
+
+void analysis_governor_get_stats(void* governor, GovernorStats* stats)
+{
+    if(!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if(!governor)
+        return;
+
+    *stats = static_cast<AnalysisGovernor*>(governor)->stats;
+}
+
+void analysis_governor_destroy(void* governor)
+{
+    delete static_cast<AnalysisGovernor*>(governor);
+}
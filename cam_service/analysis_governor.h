@@ -0,0 +1,74 @@
+#ifndef ANALYSIS_GOVERNOR_H
+#define ANALYSIS_GOVERNOR_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Regulator tempa analizy: przy ruchu (i przez holdMs po nim) analizowana
+     * jest co activeStep klatka, w spokoju krok rośnie dwukrotnie przy każdej
+     * analizie aż do idleStep. Niezależnie od tego krok nie spada poniżej
+     * wartości, przy której analiza (średni czas detektora) przekroczyłaby
+     * cpuBudget czasu jednego rdzenia.
+     *
+     * analysis_governor_update woła tylko wątek analizy,
+     * analysis_governor_step może być czytany z dowolnego wątku.
+     */
+
+    typedef struct {
+        int fps;              // klatki kamery na sekundę
+        int activeStep;       // krok przy ruchu (1 = każda klatka)
+        int idleStep;         // krok w spokoju
+        int holdMs;           // jak długo po ostatnim ruchu trzymać activeStep
+        double cpuBudget;     // dopuszczalny udział rdzenia na analizę (0.0 - 1.0]
+    } GovernorParams;
+
+    typedef struct {
+        unsigned long updates;
+        unsigned long budgetLimited;  // aktualizacje, w których budżet podniósł krok
+        int step;                     // bieżący krok
+        double avgAnalysisMs;         // średnia krocząca czasu analizy
+        double cpuLoad;               // szacowany udział rdzenia przy bieżącym kroku
+    } GovernorStats;
+
+    /**
+     * Zwraca: wskaźnik do regulatora (nieprzezroczysty) lub NULL przy złych parametrach;
+     * początkowy krok to idleStep
+     */
+    void* analysis_governor_init(GovernorParams params);
+
+    /**
+     * Co którą klatkę analizować (>= 1)
+     */
+    int analysis_governor_step(void* governor);
+
+    /**
+     * Tempo źródła zmierzone w trakcie pracy (np. odtwarzanie bez limitu,
+     * którego tempo wyznacza sam potok) zamiast GovernorParams.fps.
+     * Dowolny wątek; fps <= 0 jest ignorowane.
+     */
+    void analysis_governor_set_fps(void* governor, double fps);
+
+    /**
+     * Wynik analizy klatki przechwyconej w nowMs (ms, zegar monotoniczny)
+     * @param analysisMs - czas analizy tej klatki
+     * @return nowy krok
+     */
+    int analysis_governor_update(void* governor, bool motion, double analysisMs, long long nowMs);
+
+    /**
+     * Statystyki - z wątku analizy albo po jego zatrzymaniu
+     */
+    void analysis_governor_get_stats(void* governor, GovernorStats* stats);
+
+    void analysis_governor_destroy(void* governor);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // ANALYSIS_GOVERNOR_H
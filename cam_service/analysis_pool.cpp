@@ -0,0 +1,188 @@
+#include "analysis_pool.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct PoolSource {
+    AnalysisTaskFn fn;
+    void* source;
+    bool queued;                // czeka w kolejce gotowych
+    bool running;               // zadanie wykonuje któryś wątek
+    bool pending;               // zgłoszenie w trakcie wykonywania - ponownie do kolejki
+    Clock::time_point notifiedAt;
+    AnalysisPoolStats stats;
+};
+
+struct AnalysisPool {
+    std::mutex mutex;
+    std::condition_variable readyCv;
+    std::vector<std::thread> workers;
+
+    // chronione przez mutex; każde źródło najwyżej raz w kolejce,
+    // więc pierścień o pojemności maxSources nigdy się nie przepełni
+    std::vector<PoolSource> sources;
+    std::vector<int> ready;
+    size_t readyHead;
+    size_t readyCount;
+    bool stopping;
+};
+
+// źródło na koniec kolejki gotowych (mutex)
+static void enqueue(AnalysisPool* p, int id)
+{
+    PoolSource& s = p->sources[id];
+    s.queued = true;
+    s.notifiedAt = Clock::now();
+    p->ready[(p->readyHead + p->readyCount) % p->ready.size()] = id;
+    p->readyCount++;
+    p->readyCv.notify_one();
+}
+
+static void workerLoop(AnalysisPool* p)
+{
+    std::unique_lock<std::mutex> lock(p->mutex);
+    for(;;)
+    {
+        p->readyCv.wait(lock, [p] { return p->stopping || p->readyCount > 0; });
+        if(p->stopping)
+            return;
+
+        int id = p->ready[p->readyHead];
+        p->readyHead = (p->readyHead + 1) % p->ready.size();
+        p->readyCount--;
+
+        PoolSource& s = p->sources[id];
+        s.queued = false;
+        s.running = true;
+        double waitMs = std::chrono::duration<double, std::milli>(Clock::now() - s.notifiedAt).count();
+        if(waitMs > s.stats.maxWaitMs)
+            s.stats.maxWaitMs = waitMs;
+        s.stats.runs++;
+        AnalysisTaskFn fn = s.fn;
+        void* source = s.source;
+
+        lock.unlock();
+        fn(source);
+        lock.lock();
+
+        // zgłoszenia z czasu wykonywania - na koniec kolejki, za innymi źródłami
+        s.running = false;
+        if(s.pending)
+        {
+            s.pending = false;
+            enqueue(p, id);
+        }
+    }
+}
+
+void* analysis_pool_create(int threads, int maxSources)
+{
+    if(threads < 1 || maxSources < 1)
+        return NULL;
+
+    AnalysisPool* p = new (std::nothrow) AnalysisPool();
+    if(!p)
+        return NULL;
+
+    p->sources.reserve(maxSources);
+    p->ready.assign(maxSources, 0);
+    p->readyHead = 0;
+    p->readyCount = 0;
+    p->stopping = false;
+
+    try
+    {
+        for(int i = 0; i < threads; i++)
+            p->workers.emplace_back(workerLoop, p);
+    }
+    catch(...)
+    {
+        analysis_pool_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+int analysis_pool_add_source(void* pool, AnalysisTaskFn fn, void* source)
+{
+    if(!pool || !fn)
+        return -1;
+
+    AnalysisPool* p = static_cast<AnalysisPool*>(pool);
+    std::lock_guard<std::mutex> lock(p->mutex);
+    // bez realokacji - wątki puli trzymają referencje do elementów
+    if(p->sources.size() >= p->ready.size())
+        return -1;
+
+    PoolSource s;
+    memset(&s.stats, 0, sizeof(s.stats));
+    s.fn = fn;
+    s.source = source;
+    s.queued = false;
+    s.running = false;
+    s.pending = false;
+    p->sources.push_back(s);
+    return (int)p->sources.size() - 1;
+}
+
+void analysis_pool_notify(void* pool, int sourceId)
+{
+    if(!pool)
+        return;
+
+    AnalysisPool* p = static_cast<AnalysisPool*>(pool);
+    std::lock_guard<std::mutex> lock(p->mutex);
+    if(sourceId < 0 || sourceId >= (int)p->sources.size() || p->stopping)
+        return;
+
+    PoolSource& s = p->sources[sourceId];
+    s.stats.notifications++;
+    if(s.queued)
+        return;             // zadanie i tak weźmie najnowszą pracę
+    if(s.running)
+        s.pending = true;
+    else
+        enqueue(p, sourceId);
+}
+
+void analysis_pool_get_stats(void* pool, int sourceId, AnalysisPoolStats* stats)
+{
+    if(!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if(!pool)
+        return;
+
+    AnalysisPool* p = static_cast<AnalysisPool*>(pool);
+    std::lock_guard<std::mutex> lock(p->mutex);
+    if(sourceId >= 0 && sourceId < (int)p->sources.size())
+        *stats = p->sources[sourceId].stats;
+}
+
+void analysis_pool_stop(void* pool)
+{
+    if(!pool)
+        return;
+
+    AnalysisPool* p = static_cast<AnalysisPool*>(pool);
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->stopping = true;
+    }
+    p->readyCv.notify_all();
+    for(std::thread& worker : p->workers)
+        worker.join();
+    p->workers.clear();
+}
+
+void analysis_pool_destroy(void* pool)
+{
+    analysis_pool_stop(pool);
+    delete static_cast<AnalysisPool*>(pool);
+}
@@ -0,0 +1,66 @@
+#ifndef ANALYSIS_POOL_H
+#define ANALYSIS_POOL_H
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Wspólna pula wątków analizy dla wielu źródeł (kamer). Źródło zgłasza
+     * analysis_pool_notify, gdy ma nową pracę; wątki puli wywołują jego zadanie
+     * w kolejności zgłoszeń (round-robin), więc żadna kamera nie zagłodzi
+     * pozostałych niezależnie od tempa swojego wątku libuvc.
+     *
+     * Zadanie jednego źródła nigdy nie działa równolegle samo ze sobą - detektor
+     * i pierścień analizy kamery mają jednego konsumenta naraz. Zgłoszenia
+     * w trakcie wykonywania lub oczekiwania zadania są łączone w jedno
+     * kolejne wywołanie (zadanie i tak bierze najnowszą klatkę).
+     */
+
+    // przetworzenie zaległej pracy źródła (wątek puli)
+    typedef void (*AnalysisTaskFn)(void* source);
+
+    // Statystyki jednego źródła od dodania
+    typedef struct {
+        unsigned long notifications;  // wywołania analysis_pool_notify
+        unsigned long runs;           // wykonania zadania
+        double maxWaitMs;             // najdłuższe czekanie od zgłoszenia do startu zadania
+    } AnalysisPoolStats;
+
+    /**
+     * Zwraca: wskaźnik do puli (nieprzezroczysty) z uruchomionymi wątkami lub NULL
+     * @param threads - liczba wątków roboczych (>= 1)
+     * @param maxSources - górna granica analysis_pool_add_source
+     */
+    void* analysis_pool_create(int threads, int maxSources);
+
+    /**
+     * Rejestracja źródła (przed jego pierwszym analysis_pool_notify)
+     * Zwraca: identyfikator źródła lub -1
+     */
+    int analysis_pool_add_source(void* pool, AnalysisTaskFn fn, void* source);
+
+    /**
+     * Źródło ma nową pracę - dowolny wątek, bez alokacji
+     */
+    void analysis_pool_notify(void* pool, int sourceId);
+
+    void analysis_pool_get_stats(void* pool, int sourceId, AnalysisPoolStats* stats);
+
+    /**
+     * Czeka na zakończenie bieżących zadań i zatrzymuje wątki; zaległe zgłoszenia
+     * przepadają, późniejsze analysis_pool_notify są ignorowane
+     */
+    void analysis_pool_stop(void* pool);
+
+    /**
+     * analysis_pool_stop (jeśli jeszcze nie było) i zwolnienie puli
+     */
+    void analysis_pool_destroy(void* pool);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // ANALYSIS_POOL_H
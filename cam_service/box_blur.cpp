@@ -0,0 +1,98 @@
+#include "box_blur.h"
+#include <math.h>
+
+typedef unsigned char uchar;
+
+int box_blur_radius_for_gauss(int ksize, int passes)
+{
+    if(passes < 1)
+        passes = 1;
+
+    // sigma jak w getGaussianKernel dla sigma <= 0
+    double sigma = 0.3 * ((ksize - 1) * 0.5 - 1) + 0.8;
+    // szerokość boxa, dla której n przebiegów ma wariancję sigma^2
+    double width = sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int radius = (int)lround((width - 1.0) / 2.0);
+    return radius < 1 ? 1 : radius;
+}
+
+static inline int clampIdx(int i, int n)
+{
+    return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+// dzielenie przez (2r+1) jako mnożenie w Q16
+static inline unsigned int windowMul(int radius)
+{
+    const unsigned int window = (unsigned int)(2 * radius + 1);
+    return (65536u + window / 2) / window;
+}
+
+void box_blur_rows_u8(const unsigned char* src, size_t srcStride,
+                      unsigned char* dst, size_t dstStride,
+                      int width, int rowBegin, int rowEnd, int radius)
+{
+    const unsigned int mul = windowMul(radius);
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const uchar* s = src + (size_t)y * srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+
+        unsigned int sum = (unsigned int)(radius + 1) * s[0];
+        for(int i = 1; i <= radius; i++)
+            sum += s[clampIdx(i, width)];
+
+        for(int x = 0; x < width; x++)
+        {
+            d[x] = (uchar)((sum * mul + (1u << 15)) >> 16);
+            sum += s[clampIdx(x + radius + 1, width)];
+            sum -= s[clampIdx(x - radius, width)];
+        }
+    }
+}
+
+void box_blur_cols_u8(const unsigned char* src, size_t srcStride,
+                      unsigned char* dst, size_t dstStride,
+                      int width, int height, int rowBegin, int rowEnd, int radius,
+                      unsigned int* colSums)
+{
+    const unsigned int mul = windowMul(radius);
+
+    // suma okna dla pierwszego wiersza pasa (wiersze spoza obrazu powielane)
+    for(int x = 0; x < width; x++)
+        colSums[x] = 0;
+    for(int i = rowBegin - radius; i <= rowBegin + radius; i++)
+    {
+        const uchar* s = src + (size_t)clampIdx(i, height) * srcStride;
+        for(int x = 0; x < width; x++)
+            colSums[x] += s[x];
+    }
+
+    // dalej sumy biegnące kolumn (wiersz po wierszu, ciągły dostęp)
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        uchar* d = dst + (size_t)y * dstStride;
+        const uchar* add = src + (size_t)clampIdx(y + radius + 1, height) * srcStride;
+        const uchar* sub = src + (size_t)clampIdx(y - radius, height) * srcStride;
+        for(int x = 0; x < width; x++)
+        {
+            d[x] = (uchar)((colSums[x] * mul + (1u << 15)) >> 16);
+            colSums[x] += add[x];
+            colSums[x] -= sub[x];
+        }
+    }
+}
+
+void box_blur_u8(const unsigned char* src, size_t srcStride,
+                 unsigned char* dst, size_t dstStride,
+                 int width, int height, int radius, int passes,
+                 unsigned char* tmp, unsigned int* colSums)
+{
+    for(int p = 0; p < passes; p++)
+    {
+        const uchar* in = p == 0 ? src : dst;
+        size_t inStride = p == 0 ? srcStride : dstStride;
+        box_blur_rows_u8(in, inStride, tmp, dstStride, width, 0, height, radius);
+        box_blur_cols_u8(tmp, dstStride, dst, dstStride, width, height, 0, height, radius, colSums);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef BOX_BLUR_H
+#define BOX_BLUR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Promień boxa, dla którego `passes` przebiegów przybliża Gaussa
+     * o kernelu ksize x ksize (sigma liczona jak w OpenCV dla sigma = 0)
+     */
+    int box_blur_radius_for_gauss(int ksize, int passes);
+
+    /**
+     * Wielokrotne rozmycie boxem (sumy biegnące, osobno wiersze i kolumny).
+     * Koszt nie zależy od promienia. Brzegi powielane (replicate).
+     * Może działać w miejscu (src == dst).
+     *
+     * @param tmp - bufor roboczy width x height (krok dstStride)
+     * @param colSums - bufor roboczy na width sum kolumn
+     */
+    void box_blur_u8(const unsigned char* src, size_t srcStride,
+                     unsigned char* dst, size_t dstStride,
+                     int width, int height, int radius, int passes,
+                     unsigned char* tmp, unsigned int* colSums);
+
+    /**
+     * Pojedynczy przebieg poziomy dla wierszy [rowBegin, rowEnd) - do podziału na pasy
+     */
+    void box_blur_rows_u8(const unsigned char* src, size_t srcStride,
+                          unsigned char* dst, size_t dstStride,
+                          int width, int rowBegin, int rowEnd, int radius);
+
+    /**
+     * Pojedynczy przebieg pionowy dla wierszy [rowBegin, rowEnd).
+     * Czyta wiersze src do `radius` poza pasem, więc sąsiednie pasy src
+     * muszą być już gotowe.
+     *
+     * @param colSums - bufor roboczy na width sum kolumn (osobny dla każdego pasa)
+     */
+    void box_blur_cols_u8(const unsigned char* src, size_t srcStride,
+                          unsigned char* dst, size_t dstStride,
+                          int width, int height, int rowBegin, int rowEnd, int radius,
+                          unsigned int* colSums);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // BOX_BLUR_H
@@ -3,56 +3,244 @@
 #include <string.h>
 #include <libuvc/libuvc.h>
 #include <libwebsockets.h>
+#include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "common.h"
 #include "motion_detector.h"
+#include "frame_ring.h"
+#include "frame_pool.h"
+#include "jpeg_encoder.h"
+#include "tile_delta.h"
+#include "clip_recorder.h"
+#include "analysis_governor.h"
+#include "analysis_pool.h"
+#include "capture_source.h"
+#include "uvc_source.h"
+#include "replay_source.h"
 
 #define PORT 2138
 #define MAX_FRAME_SIZE (2 * 1024 * 1024)
 #define FPS 30
 #define STREAM_FPS 5
 #define STREAM_STEP (FPS / STREAM_FPS)  // = 30/5 = 6
-#define FPS_INTERVAL (1000 / STREAM_FPS)
 #define JSON_INTERVAL_MS 10000
-#define LWS_TIMEOUT 100
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-#define MIN_INTERVAL MIN(FPS_INTERVAL, JSON_INTERVAL_MS)
-#define FRAME_ANALYZE_STEP 15
+#define WS_FRAGMENT_SIZE (64 * 1024) // klatka wysyłana w kawałkach - jeden na SERVER_WRITEABLE
+#define LWS_TIMEOUT 1000      // górne ograniczenie czekania pętli - budzą ją lws_cancel_service i timery
+#define ANALYZE_STEP_ACTIVE 1   // przy ruchu - każda klatka
+#define ANALYZE_STEP_IDLE 30    // w spokoju - raz na sekundę
+#define ANALYZE_HOLD_MS 10000   // szybka analiza jeszcze tyle po ostatnim ruchu
+#define ANALYSIS_CPU_BUDGET 0.5 // detektor może zająć najwyżej pół rdzenia
+#define STEP_LOG_INTERVAL_MS 10000 // zmiana kroku analizy w logu najwyżej tak często
+#define HEADLESS_ANALYZE_STEP 6 // --headless bez klientów: najwyżej 5 analiz na sekundę
+#define MAX_CAMERAS 4
+#define ANALYSIS_WORKERS 2      // wspólne wątki analizy wszystkich kamer (--workers)
+#define FRAME_WIDTH 640        // domyślne przechwytywanie YUYV
+#define FRAME_HEIGHT 480
+#define MJPEG_DEFAULT_WIDTH 1280
+#define MJPEG_DEFAULT_HEIGHT 720
+#define ANALYSIS_RING_SLOTS 4
+#define FRAME_POOL_SLOTS 6    // przechwytywana + streamowana + wysyłana + analizowana + zapas w pierścieniu
+#define JPEG_DEFAULT_QUALITY 80
+#define ENCODED_POOL_SLOTS 3  // kodowana + streamowana + wysyłana
+#define ENCODE_LOG_EVERY 300  // co ile klatek logować statystyki kodowania
+#define DELTA_TILE_SIZE 16
+#define DELTA_THRESHOLD 2     // średnia różnica na bajt kafelka, poniżej - szum
+#define DELTA_KEYFRAME_INTERVAL (STREAM_FPS * 10) // pełna klatka co 10 s
+#define DELTA_CHAIN_SLOTS STREAM_FPS  // ostatnie pakiety dla klientów w tyle - 1 s zaległości bez klatki kluczowej
+#define DELTA_FORCED_KEYFRAME_GAP (STREAM_FPS * 2) // wymuszona klatka kluczowa najwyżej co tyle pakietów
+#define MOTION_STOP_MS 3000   // koniec ruchu po tylu ms bez wykrycia
+#define MOTION_EVENT_SLOTS 16 // zdarzenia czekające na wolnych klientów
+#define CLIP_PRE_SECONDS 5
+#define CLIP_POST_SECONDS 10
+#define CLIP_MAX_SECONDS 300  // dłuższy ruch - kolejny plik
+#define CLIP_DEFAULT_MEMORY_MB 16
 
+// Zmiana stanu ruchu - wysyłana klientom od razu, niezależnie od heartbeatu JSON
 typedef struct {
-    volatile bool connectionEstablished;
-    struct timespec lastJsonSentTime;
-    struct timespec lastFrameSentTime;
-    unsigned char frameBuffer[MAX_FRAME_SIZE];
-    size_t frameSize;
-    unsigned char prevFrameBuffer[MAX_FRAME_SIZE];
-    size_t prevFrameSize;
-    volatile int hasNewFrame;
+    bool start;                   // true = początek ruchu, false = koniec
+    long long captureMs;          // przechwycenie klatki, która zmieniła stan (CLOCK_MONOTONIC)
+    long long detectMs;           // koniec analizy tej klatki
+    float score;                  // udział zmienionych pikseli (MotionResult.score)
+} MotionEvent;
+
+// Potok jednej kamery - każda ma własne klatki, detektor, koder i klientów
+typedef struct {
+    int index;                    // numer kamery - ścieżka WebSocket /camN
+    CaptureSource *source;        // kamera UVC albo odtwarzanie plików (--replay)
+    bool streaming;               // capture_source_start się powiódł
+    bool encoding;                // działa wątek kodowania
+    pthread_t encodeTid;
+    volatile int clientCount;     // połączeni klienci - przechwytywanie tylko gdy > 0
+    bool backpressure;            // --replay-fps 0: źródło czeka na analizę i kodowanie, zamiast gubić klatki
+    CaptureFormat captureFormat;  // CAPTURE_FORMAT_YUYV lub CAPTURE_FORMAT_MJPEG
+    int frameWidth;
+    int frameHeight;
+    size_t maxFrameSize;          // pojemność klatki w puli (YUYV: dokładny rozmiar)
+    void* framePool;              // klatki współdzielone przez przechwytywanie, analizę i streaming
+    FrameSlot* streamFrame;       // najnowsza klatka dla wszystkich klientów (referencja, chroniona mutexem)
+    unsigned long streamSequence; // numer streamFrame - rośnie z każdą publikacją (mutex)
     volatile int frameCounter;
-    volatile bool motionDetectedFlag;
-    void* motionDetector;
+    int analysisCountdown;        // klatki do następnej analizy (mutex)
+    void* analysisGovernor;       // krok analizy: czyta callback kamery, aktualizuje wątek analizy
+    int loggedStep;               // krok z ostatniego logu (tylko wątek analizy)
+    long long stepLoggedMs;       // czas tego logu (tylko wątek analizy)
+    unsigned long motionEvents;   // analizy z wykrytym ruchem od startu (mutex)
+    MotionEvent eventLog[MOTION_EVENT_SLOTS]; // ostatnie zmiany stanu (mutex)
+    unsigned long eventCount;     // zmiany stanu od startu; eventLog[n % MOTION_EVENT_SLOTS] (mutex)
+    bool motionActive;            // stan ruchu (tylko wątek analizy)
+    long long lastMotionMs;       // ostatnia klatka z ruchem (tylko wątek analizy)
+    void* motionDetector;         // używany tylko przez wątek analizy
+    bool headless;                // --headless: detekcja także bez klientów (mutex)
+    void* headlessDetector;       // mniejsza skala analizy bez klientów (tylko wątek analizy)
+    void* activeDetector;         // detektor ostatniej analizy (tylko wątek analizy)
+    void* analysisRing;           // FrameSlot* do analizy: callback kamery -> wątek analizy
+    unsigned long analysisSkipped; // klatki pominięte przez wątek analizy (nie najnowsze)
+    unsigned long analysisQueued; // klatki wstawione do analysisRing (tylko wątek źródła)
+    unsigned long analysisDone;   // klatki z analysisRing przeanalizowane lub pominięte (atomowo)
+    void* analysisPool;           // wspólna pula wątków analizy (ServiceState)
+    int analysisSource;           // źródło tej kamery w analysisPool
+    bool resetDetector;           // prośba o reset detektora (obsługuje wątek analizy)
+    void* jpegEncoder;            // NULL = stream surowego YUYV; używany tylko przez wątek kodowania
+    void* deltaEncoder;           // tile-delta zamiast surowego YUYV; tylko wątek kodowania
+    bool keyframeRequested;       // klient czeka na klatkę kluczową tile-delta (atomowo)
+    FrameSlot* deltaChain[DELTA_CHAIN_SLOTS]; // tile-delta: pakiet n w deltaChain[n % DELTA_CHAIN_SLOTS] (referencje, mutex)
+    void* encodedPool;            // zakodowane klatki (z zapasem LWS_PRE)
+    void* clipRecorder;           // NULL = bez klipów; dostaje klatki JPEG streamu
+    FrameSlot* encodeInput;       // najnowsza klatka do zakodowania (wymiana atomowa)
+    sem_t encodeReady;
+    pthread_mutex_t pipelineMutex; // backpressure: źródło czeka na pipelineCond
+    pthread_cond_t pipelineCond;  // analiza lub kodowanie przyjęły klatkę, zatrzymanie
+    unsigned long idleWakeups;    // SERVER_WRITEABLE bez niczego do wysłania (tylko wątek lws)
+    unsigned long framesSent;     // klatki wysłane w całości, suma po klientach (tylko wątek lws)
     pthread_mutex_t mutex;
 } AppState;
 
-static long long timespecDiffMs(struct timespec *start, struct timespec *end)
+// Stan całej usługi (lws_context_user)
+typedef struct {
+    AppState cameras[MAX_CAMERAS];
+    int cameraCount;              // kamery z zainicjalizowanym AppState (mutex, semafor)
+    void* analysisPool;           // wątki analizy dzielone przez detektory wszystkich kamer
+    unsigned long serviceWakeups; // obiegi pętli lws_service (tylko wątek lws)
+} ServiceState;
+
+// Stan jednego klienta WebSocket (per_session_data) - każdy ma własny kursor
+// streamu, więc wolny klient nie spowalnia pozostałych ani przechwytywania
+typedef struct {
+    AppState *camera;             // kamera wybrana ścieżką połączenia
+    bool jsonDue;                 // minął JSON_INTERVAL_MS (LWS_CALLBACK_TIMER)
+    bool needKeyframe;            // tile-delta: klient nie ma obrazu bazowego
+    unsigned long eventSequence;  // następne zdarzenie ruchu do wysłania
+    unsigned long frameSequence;  // numer ostatnio wysłanej klatki
+    unsigned long motionEvents;   // stan motionEvents przy ostatnim JSON
+    unsigned long framesSent;
+    unsigned long framesSkipped;  // klatki, które przepadły (drop-to-latest)
+    FrameSlot *sending;           // klatka w trakcie wysyłki (referencja)
+    size_t sendOffset;            // bajty sending już przekazane do lws_write
+    unsigned char fragment[LWS_PRE + WS_FRAGMENT_SIZE]; // dalsze fragmenty z miejscem na nagłówek
+} ClientSession;
+
+static double elapsedMs(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static long long monotonicMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000LL;
+}
+
+// nowa klatka do wysłania; przejmuje referencję slot
+static void publishStreamFrame(AppState *state, FrameSlot *slot)
+{
+    // kopia do bufora klipów (bez I/O) - zapis na kartę w wątku rejestratora
+    if (state->clipRecorder)
+        clip_recorder_push(state->clipRecorder, slot->data, slot->size, slot->timestampMs);
+
+    pthread_mutex_lock(&state->mutex);
+    FrameSlot *old = state->streamFrame;
+    FrameSlot *evicted = NULL;
+    state->streamFrame = slot;
+    state->streamSequence++;
+    if (state->deltaEncoder)
+    {
+        // pakiety różnicowe trzeba wysłać po kolei - klient w tyle dostaje je z łańcucha
+        FrameSlot **link = &state->deltaChain[state->streamSequence % DELTA_CHAIN_SLOTS];
+        evicted = *link;
+        frame_slot_ref(slot);
+        *link = slot;
+    }
+    pthread_mutex_unlock(&state->mutex);
+    frame_slot_unref(old);
+    frame_slot_unref(evicted);
+
+    // wybudzenie pętli lws - klienci dostaną klatkę od razu (EVENT_WAIT_CANCELLED)
+    if (lwsContext)
+        lws_cancel_service(lwsContext);
+}
+
+// format sprawdza już źródło - tu tylko rozmiar
+static bool validCaptureFrame(AppState *state, const unsigned char *data, size_t size)
+{
+    if (!data)
+        return false;
+    // MJPEG ma zmienny rozmiar - tylko górne ograniczenie z negocjacji strumienia
+    if (state->captureFormat == CAPTURE_FORMAT_MJPEG)
+        return size > 0 && size <= state->maxFrameSize;
+    return size == state->maxFrameSize;
+}
+
+// --replay-fps 0: zamiast gubić klatki źródło czeka, aż potok je przyjmie -
+// przepustowość źródła to wtedy przepustowość analizy i kodowania.
+// Analiza: najwyżej jedna klatka w toku i jedna w kolejce; kodowanie: wątek
+// kodowania odebrał poprzednią klatkę
+static bool pipelineBusy(AppState *state, bool analyze, bool encode)
+{
+    if (analyze && state->analysisQueued - __atomic_load_n(&state->analysisDone, __ATOMIC_ACQUIRE) >= 2)
+        return true;
+    return encode && __atomic_load_n(&state->encodeInput, __ATOMIC_ACQUIRE);
+}
+
+static void waitForPipeline(AppState *state, bool analyze, bool encode)
+{
+    pthread_mutex_lock(&state->pipelineMutex);
+    while (!stopRequested && pipelineBusy(state, analyze, encode))
+        pthread_cond_wait(&state->pipelineCond, &state->pipelineMutex);
+    pthread_mutex_unlock(&state->pipelineMutex);
+}
+
+// budzi źródło czekające w waitForPipeline (stan zmieniony przed wywołaniem)
+static void wakePipeline(AppState *state)
 {
-    return (end->tv_sec - start->tv_sec) * 1000LL +
-           (end->tv_nsec - start->tv_nsec) / 1000000LL;
+    if (!state->backpressure)
+        return;
+    pthread_mutex_lock(&state->pipelineMutex);
+    pthread_cond_broadcast(&state->pipelineCond);
+    pthread_mutex_unlock(&state->pipelineMutex);
 }
 
-static void callbackUVC(uvc_frame_t *frame, void *ptr)
+// klatka ze źródła (wątek libuvc lub odtwarzania)
+static void callbackCapture(const unsigned char *data, size_t size, void *ptr)
 {
     AppState *state = (AppState*)ptr;
 
-    if (!state->connectionEstablished)
+    // z klipami lub --headless kamera i analiza pracują także bez klientów;
+    // strumień źródła jest ten sam - bez klientów zmienia się tylko, co z klatką robimy
+    bool viewers = state->clientCount > 0;
+    if (!viewers && !state->headless && !state->clipRecorder)
         return;
 
-    if (!frame || frame->data_bytes != (size_t)(640 * 480 * 2))
+    if (!validCaptureFrame(state, data, size))
     {
-        fprintf(stderr, "[callbackUVC] Nieprawidłowa klatka: %zu bajtów\n",
-                frame ? frame->data_bytes : 0);
+        fprintf(stderr, "[callbackCapture] Nieprawidłowa klatka: %zu bajtów\n", size);
         return;
     }
 
@@ -64,37 +252,482 @@ static void callbackUVC(uvc_frame_t *frame, void *ptr)
         state->frameCounter = 0;
     }
 
-    // Jeśli nie czas na klatke - po prostu pomijamy, nie zapisujemy do prev
-    if (state->frameCounter % STREAM_STEP == 0)
+    // bez klientów stream potrzebny tylko klipom
+    bool stream = (viewers || state->clipRecorder) && state->frameCounter % STREAM_STEP == 0;
+
+    // krok analizy wyznacza regulator - szybciej przy ruchu, wolno w spokoju;
+    // bez klientów (--headless) nigdy częściej niż co HEADLESS_ANALYZE_STEP
+    bool analyze = --state->analysisCountdown <= 0;
+    if (analyze)
+    {
+        int step = analysis_governor_step(state->analysisGovernor);
+        if (!viewers && state->headless && step < HEADLESS_ANALYZE_STEP)
+            step = HEADLESS_ANALYZE_STEP;
+        state->analysisCountdown = step;
+    }
+
+    pthread_mutex_unlock(&state->mutex);
+
+    // Jeśli nie czas na klatke - po prostu pomijamy
+    if (!stream && !analyze)
+        return;
+
+    bool encode = stream && (state->jpegEncoder || state->deltaEncoder);
+    if (state->backpressure)
+        waitForPipeline(state, analyze, encode);
+
+    // jedyna kopia z bufora źródła - dalej klatka krąży po wskaźniku;
+    // gdy wszystkie klatki puli są w użyciu, pomijamy (frame_pool_exhausted)
+    FrameSlot *slot = frame_pool_acquire(state->framePool);
+    if (!slot)
+        return;
+    memcpy(slot->data, data, size);
+    slot->size = size;
+    slot->timestampMs = monotonicMs();
+
+    // analiza: tylko co krok regulatora, w osobnym wątku - callback nie czeka
+    // na detektor; przy przeciążeniu klatka jest odrzucana (frame_ring_dropped)
+    if (analyze)
     {
-        if(state->frameSize > 0)
+        frame_slot_ref(slot);
+        if (frame_ring_push(state->analysisRing, (const unsigned char*)&slot, sizeof(slot)))
         {
-            memcpy(state->prevFrameBuffer, state->frameBuffer, state->frameSize);
-            state->prevFrameSize = state->frameSize;
+            state->analysisQueued++;
+            analysis_pool_notify(state->analysisPool, state->analysisSource);
+        }
+        else
+        {
+            frame_slot_unref(slot);
         }
-        memcpy(state->frameBuffer, frame->data, frame->data_bytes);
-        state->frameSize = frame->data_bytes;
-        state->hasNewFrame = 1;
     }
-    // analiza: tylko co FRAME_ANALYZE_STEP 
-    if(state->frameCounter % FRAME_ANALYZE_STEP == 0)
+
+    // MJPEG z kamery idzie do klientów bez zmian; YUYV opcjonalnie kodowane do JPEG / tile-delta
+    if (encode)
     {
-        // Jeśli mamy poprzednią klatkę, analizuj
-        if(state->prevFrameSize > 0)
+        // kodowanie w osobnym wątku; niezakodowana jeszcze starsza klatka jest pomijana
+        frame_slot_ref(slot);
+        frame_slot_unref(__atomic_exchange_n(&state->encodeInput, slot, __ATOMIC_ACQ_REL));
+        sem_post(&state->encodeReady);
+    }
+    else if (stream)
+    {
+        frame_slot_ref(slot);
+        publishStreamFrame(state, slot);
+    }
+    frame_slot_unref(slot);
+}
+
+static void logJpegStats(const JpegEncoderStats *stats)
+{
+    fprintf(stderr, "[JPEG] Klatek: %lu (błędy: %lu), czas śr. %.2f ms, max %.2f ms, ostatni %.2f ms, %zu B\n",
+            stats->frames, stats->failed, stats->frames ? stats->totalMs / stats->frames : 0.0,
+            stats->maxMs, stats->lastMs, stats->lastBytes);
+}
+
+static void logDeltaStats(const TileDeltaStats *stats)
+{
+    fprintf(stderr, "[DELTA] Pakietów: %lu (kluczowych: %lu, błędy: %lu), wysłane kafelki: %.1f%%, śr. %zu B\n",
+            stats->frames, stats->keyframes, stats->failed,
+            stats->tilesTotal ? 100.0 * stats->tilesSent / stats->tilesTotal : 0.0,
+            stats->frames ? stats->totalBytes / stats->frames : 0);
+}
+
+static void* encodeThread(void *ptr)
+{
+    AppState *state = (AppState*)ptr;
+    // pakiety od ostatniej klatki kluczowej - wolny klient nie może wymuszać
+    // pełnych klatek u wszystkich częściej niż co DELTA_FORCED_KEYFRAME_GAP
+    unsigned long sinceKeyframe = DELTA_FORCED_KEYFRAME_GAP;
+
+    while (!stopRequested)
+    {
+        if (sem_wait(&state->encodeReady) != 0)
+            continue;   // EINTR
+        if (stopRequested)
+            break;
+
+        FrameSlot *raw = __atomic_exchange_n(&state->encodeInput, (FrameSlot*)NULL, __ATOMIC_ACQ_REL);
+        if (!raw)
+            continue;
+        wakePipeline(state);
+
+        // klatka kodowana raz - wszyscy odbiorcy dostają ten sam slot
+        FrameSlot *encoded = frame_pool_acquire(state->encodedPool);
+        if (encoded && state->jpegEncoder)
         {
-            bool motionNow = motion_detector_detect(
-                state->motionDetector,
-                (const unsigned char*)frame->data, frame->data_bytes,
-                state->prevFrameBuffer, state->prevFrameSize
-            );
-            if(motionNow)
+            encoded->size = jpeg_encoder_encode(state->jpegEncoder, raw->data, raw->size,
+                                                encoded->data, encoded->capacity);
+        }
+        else if (encoded)
+        {
+            if (sinceKeyframe >= DELTA_FORCED_KEYFRAME_GAP &&
+                __atomic_exchange_n(&state->keyframeRequested, false, __ATOMIC_ACQ_REL))
+                tile_delta_force_keyframe(state->deltaEncoder);
+            encoded->size = tile_delta_encode(state->deltaEncoder, raw->data, raw->size,
+                                              encoded->data, encoded->capacity);
+            if (encoded->size > 0 && tile_delta_is_keyframe(encoded->data, encoded->size))
+            {
+                // także okresowa klatka kluczowa spełnia zaległą prośbę
+                __atomic_store_n(&state->keyframeRequested, false, __ATOMIC_RELEASE);
+                sinceKeyframe = 0;
+            }
+            else if (encoded->size > 0)
             {
-                state->motionDetectedFlag = true;
+                sinceKeyframe++;
             }
         }
+        if (encoded)
+            encoded->timestampMs = raw->timestampMs;
+        frame_slot_unref(raw);
+
+        if (encoded && encoded->size > 0)
+            publishStreamFrame(state, encoded);
+        else
+            frame_slot_unref(encoded);
+
+        if (state->jpegEncoder)
+        {
+            JpegEncoderStats stats;
+            jpeg_encoder_get_stats(state->jpegEncoder, &stats);
+            if (stats.frames > 0 && stats.frames % ENCODE_LOG_EVERY == 0)
+                logJpegStats(&stats);
+        }
+        else
+        {
+            TileDeltaStats stats;
+            tile_delta_get_stats(state->deltaEncoder, &stats);
+            if (stats.frames > 0 && stats.frames % ENCODE_LOG_EVERY == 0)
+                logDeltaStats(&stats);
+        }
     }
-    
+    return NULL;
+}
+
+// klatka z analysisRing obsłużona - przeanalizowana albo pominięta
+static void analysisFrameDone(AppState *state, FrameSlot *slot)
+{
+    if (!slot)
+        return;
+    frame_slot_unref(slot);
+    __atomic_fetch_add(&state->analysisDone, 1, __ATOMIC_RELEASE);
+    wakePipeline(state);
+}
+
+// najnowsza klatka z pierścienia analizy (z referencją) lub NULL;
+// starsze od razu wracają do puli
+static FrameSlot* takeNewestAnalysisFrame(AppState *state)
+{
+    FrameSlot *newest = NULL;
+    const unsigned char *entry;
+    while ((entry = frame_ring_acquire_next(state->analysisRing, NULL)))
+    {
+        FrameSlot *slot;
+        memcpy(&slot, entry, sizeof(slot));
+        frame_ring_release(state->analysisRing);
+
+        if (newest)
+        {
+            analysisFrameDone(state, newest);
+            __atomic_fetch_add(&state->analysisSkipped, 1, __ATOMIC_RELAXED);
+        }
+        newest = slot;
+    }
+    return newest;
+}
+
+// zdarzenie do dziennika i wybudzenie pętli lws - klienci dostają je
+// w najbliższym SERVER_WRITEABLE, bez czekania na klatkę czy heartbeat
+static void publishMotionEvent(AppState *state, bool start, long long captureMs, float score)
+{
+    MotionEvent event = {start, captureMs, monotonicMs(), score};
+    pthread_mutex_lock(&state->mutex);
+    state->eventLog[state->eventCount % MOTION_EVENT_SLOTS] = event;
+    state->eventCount++;
     pthread_mutex_unlock(&state->mutex);
+
+    fprintf(stderr, "[MOTION] Kamera %d: %s ruchu (wynik %.4f, opóźnienie %lld ms)\n",
+            state->index, start ? "początek" : "koniec", score, event.detectMs - captureMs);
+    if (lwsContext)
+        lws_cancel_service(lwsContext);
+}
+
+// zadanie kamery w puli analizy - pula nie uruchamia go równolegle dla tej samej
+// kamery, więc detektor i pierścień analizy mają jednego konsumenta naraz
+static void analysisTask(void *ptr)
+{
+    AppState *state = (AppState*)ptr;
+
+    // reset zlecony przez WebSocket - stare klatki też są już nieaktualne
+    if (__atomic_exchange_n(&state->resetDetector, false, __ATOMIC_ACQ_REL))
+    {
+        motion_detector_reset(state->motionDetector);
+        motion_detector_reset(state->headlessDetector);
+        analysisFrameDone(state, takeNewestAnalysisFrame(state));
+        return;
+    }
+
+    // zgłoszenia z czasu poprzedniej analizy są łączone - pominięte starsze klatki
+    FrameSlot *slot = takeNewestAnalysisFrame(state);
+    if (!slot)
+        return;
+
+    // bez klientów tańszy detektor; po przełączeniu jego poprzednia klatka jest nieaktualna
+    void *detector = state->motionDetector;
+    if (state->headlessDetector && state->clientCount == 0)
+        detector = state->headlessDetector;
+    if (detector != state->activeDetector)
+    {
+        motion_detector_reset(detector);
+        state->activeDetector = detector;
+    }
+
+    // detektor sam pamięta poprzednią analizowaną klatkę
+    MotionResult result;
+    struct timespec analysisStart;
+    clock_gettime(CLOCK_MONOTONIC, &analysisStart);
+    bool motionNow = motion_detector_push_frame_ex(detector, slot->data, slot->size, &result);
+    long long captureMs = slot->timestampMs;
+    analysisFrameDone(state, slot);
+
+    int step = analysis_governor_update(state->analysisGovernor, motionNow,
+                                        elapsedMs(&analysisStart), captureMs);
+    // przy czasie analizy na granicy budżetu krok potrafi skakać co analizę -
+    // do logu tylko bieżący krok, najwyżej raz na STEP_LOG_INTERVAL_MS
+    if (step != state->loggedStep && captureMs - state->stepLoggedMs >= STEP_LOG_INTERVAL_MS)
+    {
+        fprintf(stderr, "[MOTION] Kamera %d: analiza co %d klatek (było %d)\n",
+                state->index, step, state->loggedStep);
+        state->loggedStep = step;
+        state->stepLoggedMs = captureMs;
+    }
+
+    if (motionNow)
+    {
+        pthread_mutex_lock(&state->mutex);
+        state->motionEvents++;
+        pthread_mutex_unlock(&state->mutex);
+        if (state->clipRecorder)
+            clip_recorder_trigger(state->clipRecorder, captureMs);
+        state->lastMotionMs = captureMs;
+    }
+
+    // zbocza: początek przy pierwszym wykryciu, koniec po MOTION_STOP_MS ciszy
+    if (motionNow != state->motionActive &&
+        (motionNow || captureMs - state->lastMotionMs >= MOTION_STOP_MS))
+    {
+        state->motionActive = motionNow;
+        publishMotionEvent(state, motionNow, captureMs, result.score);
+    }
+}
+
+static void requestDetectorReset(AppState *state)
+{
+    __atomic_store_n(&state->resetDetector, true, __ATOMIC_RELEASE);
+    analysis_pool_notify(state->analysisPool, state->analysisSource);
+}
+
+// zatrzymanie wątku roboczego (ustawia stopRequested, budzi go i czeka na koniec)
+static void stopWorkerThread(sem_t *wake, pthread_t tid)
+{
+    stopRequested = true;
+    sem_post(wake);
+    pthread_join(tid, NULL);
+}
+
+// wątki robocze i kamera muszą być już zatrzymane
+// tile-delta: zwolnienie łańcucha ostatnich pakietów (mutex lub wątki zatrzymane)
+static void clearDeltaChain(AppState *state)
+{
+    for (int i = 0; i < DELTA_CHAIN_SLOTS; i++)
+    {
+        frame_slot_unref(state->deltaChain[i]);
+        state->deltaChain[i] = NULL;
+    }
+}
+
+static void destroyPipeline(AppState *state)
+{
+    if (state->analysisRing)
+        analysisFrameDone(state, takeNewestAnalysisFrame(state));
+    frame_slot_unref(state->encodeInput);
+    state->encodeInput = NULL;
+    frame_slot_unref(state->streamFrame);
+    state->streamFrame = NULL;
+    clearDeltaChain(state);
+
+    motion_detector_destroy(state->motionDetector);
+    motion_detector_destroy(state->headlessDetector);
+    jpeg_encoder_destroy(state->jpegEncoder);
+    tile_delta_destroy(state->deltaEncoder);
+    clip_recorder_destroy(state->clipRecorder);
+    analysis_governor_destroy(state->analysisGovernor);
+    frame_ring_destroy(state->analysisRing);
+    frame_pool_destroy(state->framePool);
+    frame_pool_destroy(state->encodedPool);
+    sem_destroy(&state->encodeReady);
+    pthread_cond_destroy(&state->pipelineCond);
+    pthread_mutex_destroy(&state->pipelineMutex);
+}
+
+static void logFrameDrops(AppState *state)
+{
+    fprintf(stderr, "[MOTION] Klatki odrzucone: %lu, pominięte: %lu, brak wolnej klatki: %lu\n",
+            frame_ring_dropped(state->analysisRing),
+            __atomic_load_n(&state->analysisSkipped, __ATOMIC_RELAXED),
+            frame_pool_exhausted(state->framePool));
+}
+
+static void logGovernorStats(AppState *state)
+{
+    GovernorStats stats;
+    analysis_governor_get_stats(state->analysisGovernor, &stats);
+    fprintf(stderr, "[MOTION] Krok analizy: %d, śr. czas analizy %.2f ms, obciążenie %.1f%% rdzenia, "
+            "ograniczenia budżetem: %lu\n", stats.step, stats.avgAnalysisMs, stats.cpuLoad * 100.0,
+            stats.budgetLimited);
+}
+
+static void logAnalysisPoolStats(AppState *state)
+{
+    AnalysisPoolStats stats;
+    analysis_pool_get_stats(state->analysisPool, state->analysisSource, &stats);
+    fprintf(stderr, "[MOTION] Zadań w puli analizy: %lu (zgłoszeń: %lu), najdłuższe czekanie na wątek %.1f ms\n",
+            stats.runs, stats.notifications, stats.maxWaitMs);
+}
+
+static void logClipStats(AppState *state)
+{
+    ClipRecorderStats stats;
+    clip_recorder_get_stats(state->clipRecorder, &stats);
+    fprintf(stderr, "[CLIP] Klipów: %lu, klatek: %lu (odrzucone: %lu), %llu B, błędy zapisu: %lu\n",
+            stats.clips, stats.framesWritten, stats.framesDropped, stats.bytesWritten, stats.writeErrors);
+}
+
+static const char* streamFormatName(AppState *state)
+{
+    if (state->deltaEncoder)
+        return "delta";
+    if (state->jpegEncoder || state->captureFormat == CAPTURE_FORMAT_MJPEG)
+        return "jpeg";
+    return "yuyv";
+}
+
+// pierwszy klient po przerwie / ostatni rozłączony - stan przechwytywania od nowa
+static void resetCaptureState(AppState *state)
+{
+    frame_slot_unref(state->streamFrame);
+    state->streamFrame = NULL;
+    clearDeltaChain(state);
+    state->frameCounter = 0;
+    requestDetectorReset(state);
+}
+
+// kolejne niewysłane zdarzenie ruchu klienta; przy zbyt dużej zaległości
+// najstarsze zdarzenia przepadają (dziennik ma MOTION_EVENT_SLOTS miejsc)
+static bool takeMotionEvent(AppState *state, ClientSession *session, MotionEvent *event)
+{
+    pthread_mutex_lock(&state->mutex);
+    bool pending = session->eventSequence != state->eventCount;
+    if (pending)
+    {
+        if (state->eventCount - session->eventSequence > MOTION_EVENT_SLOTS)
+            session->eventSequence = state->eventCount - MOTION_EVENT_SLOTS;
+        *event = state->eventLog[session->eventSequence % MOTION_EVENT_SLOTS];
+        session->eventSequence++;
+    }
+    pthread_mutex_unlock(&state->mutex);
+    return pending;
+}
+
+// czy klient ma jeszcze coś do wysłania - tylko wtedy ponowne lws_callback_on_writable
+static bool sessionHasWork(AppState *state, ClientSession *session)
+{
+    if (session->sending || session->jsonDue)
+        return true;
+    pthread_mutex_lock(&state->mutex);
+    bool pending = session->eventSequence != state->eventCount ||
+                   (state->streamFrame && state->streamSequence != session->frameSequence);
+    pthread_mutex_unlock(&state->mutex);
+    return pending;
+}
+
+// tile-delta (mutex): pakiet następny po ostatnio wysłanym, jeśli jest jeszcze
+// w łańcuchu, inaczej najnowsza klatka kluczowa z łańcucha; NULL gdy żadnej nie ma
+static FrameSlot* nextDeltaPacket(AppState *state, ClientSession *session, unsigned long *sequence)
+{
+    unsigned long oldest = state->streamSequence >= DELTA_CHAIN_SLOTS ?
+                           state->streamSequence - DELTA_CHAIN_SLOTS + 1 : 1;
+    unsigned long next = session->frameSequence + 1;
+    if (!session->needKeyframe && next >= oldest && state->deltaChain[next % DELTA_CHAIN_SLOTS])
+    {
+        *sequence = next;
+        return state->deltaChain[next % DELTA_CHAIN_SLOTS];
+    }
+
+    for (unsigned long n = state->streamSequence; n >= oldest && n > session->frameSequence; n--)
+    {
+        FrameSlot *packet = state->deltaChain[n % DELTA_CHAIN_SLOTS];
+        if (packet && tile_delta_is_keyframe(packet->data, packet->size))
+        {
+            *sequence = n;
+            return packet;
+        }
+    }
+    return NULL;
+}
+
+// kolejny fragment session->sending (LWS_WRITE_BINARY, potem LWS_WRITE_CONTINUATION);
+// po ostatnim zwalnia referencję. Zwraca -1 przy błędzie zapisu
+static int sendFrameFragment(struct lws *wsi, ClientSession *session)
+{
+    FrameSlot *slot = session->sending;
+    size_t remaining = slot->size - session->sendOffset;
+    size_t chunk = remaining < WS_FRAGMENT_SIZE ? remaining : WS_FRAGMENT_SIZE;
+    bool first = session->sendOffset == 0;
+    bool last = chunk == remaining;
+
+    unsigned char *payload;
+    if (first)
+    {
+        // klatka z puli ma przed sobą LWS_PRE bajtów na nagłówek - bez kopii
+        payload = slot->data;
+    }
+    else
+    {
+        // przed dalszymi fragmentami leżą dane klatki, które czytają też inni
+        // klienci i analiza - nagłówek lws nie może ich nadpisać
+        payload = session->fragment + LWS_PRE;
+        memcpy(payload, slot->data + session->sendOffset, chunk);
+    }
+
+    int flags = lws_write_ws_flags(LWS_WRITE_BINARY, first, last);
+    if (lws_write(wsi, payload, chunk, (enum lws_write_protocol)flags) < 0)
+        return -1;
+
+    session->sendOffset += chunk;
+    if (last)
+    {
+        frame_slot_unref(slot);
+        session->sending = NULL;
+        session->framesSent++;
+        session->camera->framesSent++;
+    }
+    return 0;
+}
+
+// kamera ze ścieżki połączenia: /camN (N od 0), samo "/" to pierwsza kamera
+static AppState* cameraForRequest(ServiceState *service, struct lws *wsi)
+{
+    char uri[64];
+    if (lws_hdr_copy(wsi, uri, sizeof(uri), WSI_TOKEN_GET_URI) <= 0)
+        return NULL;
+    if (strcmp(uri, "/") == 0)
+        return &service->cameras[0];
+
+    int index;
+    char extra;
+    if (sscanf(uri, "/cam%d%c", &index, &extra) != 1 || index < 0 || index >= service->cameraCount)
+        return NULL;
+    return &service->cameras[index];
 }
 
 static int callbackWs(struct lws *wsi, enum lws_callback_reasons reason,
@@ -102,118 +735,207 @@ static int callbackWs(struct lws *wsi, enum lws_callback_reasons reason,
 {
     (void)in;
     (void)len;
-    (void)user;
 
-    AppState *state = (AppState *)lws_context_user(lws_get_context(wsi));
-    if (!state)
+    ServiceState *service = (ServiceState *)lws_context_user(lws_get_context(wsi));
+    ClientSession *session = (ClientSession *)user;
+    if (!service)
         {
         return -1;
     }
+    // kamera sesji - ustawiana w ESTABLISHED
+    AppState *state = session ? session->camera : NULL;
 
     switch (reason)
     {
+    // nieznana ścieżka - odrzucenie jeszcze przed nawiązaniem połączenia
+    case LWS_CALLBACK_FILTER_PROTOCOL_CONNECTION:
+        if (!cameraForRequest(service, wsi))
+        {
+            fprintf(stderr, "[WS] Odrzucone połączenie - nieznana kamera\n");
+            return -1;
+        }
+        break;
+
     case LWS_CALLBACK_ESTABLISHED:
     {
-        fprintf(stderr, "[WS] Klient połączony\n");
+        state = cameraForRequest(service, wsi);
+        if (!state)
+            return -1;
+
         pthread_mutex_lock(&state->mutex);
-        state->connectionEstablished = true;
-        state->hasNewFrame = 0;
-        state->frameSize = 0;
-        state->prevFrameSize = 0;
-        state->frameCounter = 0;
-        state->motionDetectedFlag = false;
+        if (state->clientCount == 0)
+            resetCaptureState(state);
+        state->clientCount++;
 
-        struct timespec timeNow;
-        clock_gettime(CLOCK_MONOTONIC, &timeNow);
-        state->lastJsonSentTime = timeNow;
-        state->lastFrameSentTime = timeNow;
+        memset(session, 0, sizeof(*session));
+        session->camera = state;
+        session->needKeyframe = state->deltaEncoder != NULL;
+        session->frameSequence = state->streamSequence;
+        session->motionEvents = state->motionEvents;
+        session->eventSequence = state->eventCount;
+        // ruch trwa (np. wykryty w --headless przed połączeniem) - klient dostaje
+        // od razu jego początek, inaczej zobaczyłby tylko motion_stop
+        bool motionOngoing = state->eventCount > 0 &&
+                             state->eventLog[(state->eventCount - 1) % MOTION_EVENT_SLOTS].start;
+        if (motionOngoing)
+            session->eventSequence = state->eventCount - 1;
+        int clients = state->clientCount;
         pthread_mutex_unlock(&state->mutex);
 
-        lws_callback_on_writable(wsi);
+        fprintf(stderr, "[WS] Klient połączony z kamerą %d (klientów: %d)\n", state->index, clients);
+        if (clients == 1 && state->headless)
+            fprintf(stderr, "[CAM] Kamera %d: pełna jakość - stream i analiza w pełnej skali\n", state->index);
+        lws_set_timer_usecs(wsi, (lws_usec_t)JSON_INTERVAL_MS * 1000);
+        if (motionOngoing)
+            lws_callback_on_writable(wsi);
         break;
     }
 
+    // nowa klatka lub zdarzenie ruchu z innego wątku (lws_cancel_service)
+    case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+        lws_callback_on_writable_all_protocol(lws_get_context(wsi), lws_get_protocol(wsi));
+        break;
+
+    // heartbeat JSON co 10 sekund - zmiany stanu ruchu idą osobno, od razu
+    case LWS_CALLBACK_TIMER:
+        if (!state)
+            break;
+        session->jsonDue = true;
+        lws_callback_on_writable(wsi);
+        lws_set_timer_usecs(wsi, (lws_usec_t)JSON_INTERVAL_MS * 1000);
+        break;
+
     case LWS_CALLBACK_SERVER_WRITEABLE:
     {
-        if(state->connectionEstablished)
+        if (!state)
+            break;
+
+        // zapchane gniazdo - nic nie dokładamy; przy kolejnej okazji klient
+        // dostanie od razu najnowszą klatkę, pośrednie przepadną
+        if (lws_send_pipe_choked(wsi))
         {
-            pthread_mutex_lock(&state->mutex);
-            if (!state->hasNewFrame || state->frameSize == 0)
-            {
-                pthread_mutex_unlock(&state->mutex);
+            lws_callback_on_writable(wsi);
+            break;
+        }
+
+        // jedna ramka na SERVER_WRITEABLE - najpierw dokończenie rozpoczętej klatki
+        // (w trakcie wiadomości fragmentowanej nie wolno wysłać innej), potem
+        // zdarzenia ruchu, JSON i dopiero nowa klatka
+        MotionEvent event;
+        if (!session->sending && takeMotionEvent(state, session, &event))
+        {
+            unsigned char eventBuffer[LWS_PRE + 256];
+            char *json = (char*)eventBuffer + LWS_PRE;
+            int jsonLen = snprintf(json, 256,
+                "{\"event\":\"%s\",\"captureTime\":%lld,\"detectTime\":%lld,\"score\":%.4f}",
+                event.start ? "motion_start" : "motion_stop",
+                event.captureMs, event.detectMs, event.score);
+            if (lws_write(wsi, (unsigned char*)json, jsonLen, LWS_WRITE_TEXT) < 0)
+                return -1;
+
+            if (sessionHasWork(state, session))
                 lws_callback_on_writable(wsi);
-                break;
-            }
+            break;
+        }
+
+        if (!session->sending && session->jsonDue)
+        {
+            pthread_mutex_lock(&state->mutex);
+            bool motion = state->motionEvents != session->motionEvents;
+            session->motionEvents = state->motionEvents;
+            pthread_mutex_unlock(&state->mutex);
+            session->jsonDue = false;
 
             struct timespec timeNow;
             clock_gettime(CLOCK_MONOTONIC, &timeNow);
-            long long elapsedJsonTime = timespecDiffMs(&state->lastJsonSentTime, &timeNow);
-            long long elapsedFrameTime = timespecDiffMs(&state->lastFrameSentTime, &timeNow);
 
-             // wysyłaj JSON co 10 sekund
-            if(elapsedJsonTime >= JSON_INTERVAL_MS)
-            {
-                bool motion = state->motionDetectedFlag;
-                state->motionDetectedFlag = false;
-                state->lastJsonSentTime = timeNow;
-                pthread_mutex_unlock(&state->mutex);
-
-                char jsonBuffer[512];
-                snprintf(jsonBuffer, sizeof(jsonBuffer),
-                    "{\"motion\":%s,\"timestamp\":%ld}",
-                    motion ? "true" : "false",
-                    timeNow.tv_sec);
-                size_t jsonLen = strlen(jsonBuffer);
-                unsigned char *buf = (unsigned char*)malloc(LWS_PRE + jsonLen);
-                if (buf)
-                {
-                    memcpy(buf + LWS_PRE, jsonBuffer, jsonLen);
-                    lws_write(wsi, buf + LWS_PRE, jsonLen, LWS_WRITE_TEXT);
-                    free(buf);
-                }
+            // JSON od razu za miejscem na nagłówek - bez malloc i kopii
+            unsigned char jsonBuffer[LWS_PRE + 512];
+            char *json = (char*)jsonBuffer + LWS_PRE;
+            int jsonLen = snprintf(json, 512,
+                "{\"motion\":%s,\"timestamp\":%ld,\"format\":\"%s\"}",
+                motion ? "true" : "false",
+                timeNow.tv_sec,
+                streamFormatName(state));
+            if (lws_write(wsi, (unsigned char*)json, jsonLen, LWS_WRITE_TEXT) < 0)
+                return -1;
+
+            if (sessionHasWork(state, session))
                 lws_callback_on_writable(wsi);
-                break;
-            }
-            // sprawdź czy minął czas na wysłanie ramki
-            else if (elapsedFrameTime >= FPS_INTERVAL)
-            {
-                unsigned char *buf = (unsigned char*)malloc(LWS_PRE + state->frameSize);
-                if (buf)
-                {
-                    memcpy(buf + LWS_PRE, state->frameBuffer, state->frameSize);
-                    size_t frameSize = state->frameSize;
-                    state->hasNewFrame = 0;
-                    state->lastFrameSentTime = timeNow;
-                    pthread_mutex_unlock(&state->mutex);
+            break;
+        }
 
-                    lws_write(wsi, buf + LWS_PRE, frameSize, LWS_WRITE_BINARY);
-                    free(buf);
-                }
-                else
+        if (!session->sending)
+        {
+            // własna referencja - kamera może w tym czasie podmienić streamFrame.
+            // Tempo streamu (STREAM_FPS) wyznacza publikacja, tu wysyłamy każdą nową klatkę
+            pthread_mutex_lock(&state->mutex);
+            if (state->streamFrame && state->streamSequence != session->frameSequence)
+            {
+                FrameSlot *next = state->streamFrame;
+                unsigned long sequence = state->streamSequence;
+                // tile-delta: pakiet różnicowy bez wszystkich poprzedników jest bezużyteczny -
+                // kolejny pakiet z łańcucha, a gdy klient wypadł poza łańcuch, klatka
+                // kluczowa; jeśli żadnej nie ma, klient na nią czeka i prosi koder
+                if (state->deltaEncoder && !(next = nextDeltaPacket(state, session, &sequence)))
                 {
+                    session->needKeyframe = true;
+                    session->framesSkipped += state->streamSequence - session->frameSequence;
+                    session->frameSequence = state->streamSequence;
+                    __atomic_store_n(&state->keyframeRequested, true, __ATOMIC_RELEASE);
                     pthread_mutex_unlock(&state->mutex);
+                    break;
                 }
+                session->needKeyframe = false;
+                session->sending = next;
+                session->sendOffset = 0;
+                frame_slot_ref(session->sending);
+                session->framesSkipped += sequence - session->frameSequence - 1;
+                session->frameSequence = sequence;
             }
-            else
+            pthread_mutex_unlock(&state->mutex);
+
+            if (!session->sending)
             {
-                pthread_mutex_unlock(&state->mutex);
+                // nic nowego - bez ponownego lws_callback_on_writable, czekamy na publikację
+                state->idleWakeups++;
+                break;
             }
-            lws_callback_on_writable(wsi);
         }
+
+        if (sendFrameFragment(wsi, session) < 0)
+            return -1;
+
+        // reszta klatki / zaległy JSON lub zdarzenie / klatka opublikowana w trakcie wysyłki
+        if (sessionHasWork(state, session))
+            lws_callback_on_writable(wsi);
         break;
     }
 
     case LWS_CALLBACK_CLOSED:
     {
-        fprintf(stderr, "[WS] Klient rozłączony\n");
+        if (!state)
+            break;
+
         pthread_mutex_lock(&state->mutex);
-        state->connectionEstablished = false;
-        state->hasNewFrame = 0;
-        state->frameSize = 0;
-        state->prevFrameSize = 0;
-        state->frameCounter = 0;
-        state->motionDetectedFlag = false;
+        state->clientCount--;
+        if (state->clientCount == 0)
+            resetCaptureState(state);
+        int clients = state->clientCount;
         pthread_mutex_unlock(&state->mutex);
+
+        frame_slot_unref(session->sending);
+        session->sending = NULL;
+
+        fprintf(stderr, "[WS] Klient rozłączony od kamery %d (klientów: %d), wysłane klatki: %lu, pominięte: %lu\n",
+                state->index, clients, session->framesSent, session->framesSkipped);
+        if (clients == 0)
+        {
+            logFrameDrops(state);
+            if (state->headless)
+                fprintf(stderr, "[CAM] Kamera %d: brak klientów - tylko detekcja (analiza co >= %d klatek)\n",
+                        state->index, HEADLESS_ANALYZE_STEP);
+        }
         break;
     }
 
@@ -223,7 +945,438 @@ static int callbackWs(struct lws *wsi, enum lws_callback_reasons reason,
     return 0;
 }
 
-int main(void)
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Użycie: %s [--jpeg [jakość 1-100] | --delta] [--mjpeg [SZERxWYS]]"
+            " [--clips KATALOG [--clip-memory MB]] [--headless]"
+            " [--camera NUMER_SERYJNY[@SZERxWYS]]... [--camera all] [--workers N]"
+            " [--replay ŚCIEŻKA[@SZERxWYS]]... [--replay-fps N] [--replay-jitter MS] [--replay-loops N]\n", prog);
+}
+
+// Ustawienia potoku jednej kamery - wspólne z linii poleceń, rozdzielczość
+// i źródło mogą być różne dla każdej kamery
+typedef struct {
+    char source[256];             // numer seryjny kamery (pusty = dowolna) albo ścieżka --replay
+    bool mjpeg;
+    int frameWidth;
+    int frameHeight;
+    int jpegQuality;              // 0 = bez kodowania JPEG
+    bool delta;
+    bool headless;
+    char clipDirectory[256];      // pusty = bez klipów
+    int clipMemoryMb;
+    int detectorThreads;          // pasy detektora - przy wielu kamerach równoległość daje pula analizy
+    double cpuBudget;             // udział rdzenia na analizę tej kamery
+    int fps;                      // tempo źródła dla regulatora analizy
+    bool backpressure;            // --replay-fps 0: tempo źródła wyznacza potok
+} CameraConfig;
+
+// Odtwarzanie zamiast kamer (--replay) - wspólne dla wszystkich plików
+typedef struct {
+    double fps;                   // 0 = tak szybko, jak potok przyjmuje klatki
+    int jitterMs;
+    int loops;                    // 0 = bez końca
+} ReplayOptions;
+
+// SZERxWYS: wielokrotności 8, co najmniej 64x64
+static bool parseFrameSize(const char *text, int *width, int *height)
+{
+    return sscanf(text, "%dx%d", width, height) == 2 && *width >= 64 && *height >= 64 &&
+           *width % 8 == 0 && *height % 8 == 0;
+}
+
+// urządzenia kamer (z referencją): wszystkie podłączone, wybrane numerem
+// seryjnym albo pierwsza znaleziona. Zwraca liczbę kamer, 0 przy błędzie
+static int findCameras(uvc_context_t *camContext, const CameraConfig *configs, int configCount,
+                       bool all, uvc_device_t **devices)
+{
+    if (all)
+    {
+        uvc_device_t **list;
+        uvc_error_t res = uvc_get_device_list(camContext, &list);
+        if (res < 0)
+        {
+            uvc_perror(res, "get_device_list");
+            return 0;
+        }
+        int count = 0;
+        for (int i = 0; list[i] && count < MAX_CAMERAS; i++)
+        {
+            uvc_ref_device(list[i]);
+            devices[count++] = list[i];
+        }
+        uvc_free_device_list(list, 1);
+        if (count == 0)
+            fprintf(stderr, "[CAM] Nie znaleziono kamer UVC\n");
+        return count;
+    }
+
+    for (int i = 0; i < configCount; i++)
+    {
+        const char *serial = configs[i].source[0] ? configs[i].source : NULL;
+        uvc_error_t res = uvc_find_device(camContext, &devices[i], 0, 0, serial);
+        if (res < 0)
+        {
+            uvc_perror(res, "find_device");
+            fprintf(stderr, "[CAM] Brak kamery %s\n", serial ? serial : "UVC");
+            for (int j = 0; j < i; j++)
+                uvc_unref_device(devices[j]);
+            return 0;
+        }
+    }
+    return configCount;
+}
+
+// źródło UVC dla każdej znalezionej kamery; przy błędzie wszystko zwolnione, zwraca 0
+static int openCameraSources(uvc_context_t *camContext, const CameraConfig *configs, int configCount,
+                             bool all, CaptureSource **sources)
+{
+    uvc_device_t *devices[MAX_CAMERAS];
+    int count = findCameras(camContext, configs, configCount, all, devices);
+    for (int i = 0; i < count; i++)
+    {
+        const CameraConfig *config = &configs[i];
+        sources[i] = uvc_source_open(devices[i], config->mjpeg ? CAPTURE_FORMAT_MJPEG : CAPTURE_FORMAT_YUYV,
+                                     config->frameWidth, config->frameHeight, FPS);
+        if (!sources[i])
+        {
+            for (int j = 0; j < i; j++)
+                capture_source_destroy(sources[j]);
+            for (int j = i + 1; j < count; j++)
+                uvc_unref_device(devices[j]);
+            return 0;
+        }
+    }
+    return count;
+}
+
+// źródło odtwarzania dla każdego --replay; przy błędzie wszystko zwolnione, zwraca 0
+static int openReplaySources(const CameraConfig *configs, int configCount, const ReplayOptions *options,
+                             CaptureSource **sources)
+{
+    for (int i = 0; i < configCount; i++)
+    {
+        ReplaySourceParams params = {
+            .path = configs[i].source,
+            .width = configs[i].frameWidth,
+            .height = configs[i].frameHeight,
+            .fps = options->fps,
+            .jitterMs = options->jitterMs,
+            .loops = options->loops,
+            .seed = (unsigned int)i + 1
+        };
+        sources[i] = replay_source_open(params);
+        if (!sources[i])
+        {
+            fprintf(stderr, "[REPLAY] Nie można odtworzyć %s\n", configs[i].source);
+            for (int j = 0; j < i; j++)
+                capture_source_destroy(sources[j]);
+            return 0;
+        }
+    }
+    return configCount;
+}
+
+// wszystkie źródła same się skończyły (odtwarzanie z --replay-loops)
+static bool sourcesFinished(ServiceState *service)
+{
+    for (int i = 0; i < service->cameraCount; i++)
+    {
+        if (!capture_source_finished(service->cameras[i].source))
+            return false;
+    }
+    return true;
+}
+
+// AppState kamery i potok klatek dla formatu źródła. Przejmuje source;
+// także po błędzie (false) kamerę zwalnia closeCamera
+static bool initCamera(AppState *state, int index, CaptureSource *source, const CameraConfig *config,
+                       void *analysisPool)
+{
+    CaptureInfo info;
+    capture_source_get_info(source, &info);
+    bool mjpeg = info.format == CAPTURE_FORMAT_MJPEG;
+    int frameWidth = info.width;
+    int frameHeight = info.height;
+
+    AppState initial = {
+        .index = index,
+        .source = source,
+        .streaming = false,
+        .encoding = false,
+        .encodeTid = {},
+        .clientCount = 0,
+        .backpressure = config->backpressure,
+        .captureFormat = info.format,
+        .frameWidth = frameWidth,
+        .frameHeight = frameHeight,
+        .maxFrameSize = info.maxFrameSize,
+        .framePool = NULL,
+        .streamFrame = NULL,
+        .streamSequence = 0,
+        .frameCounter = 0,
+        .analysisCountdown = 0,
+        .analysisGovernor = NULL,
+        .loggedStep = 0,
+        .stepLoggedMs = 0,
+        .motionEvents = 0,
+        .eventLog = {},
+        .eventCount = 0,
+        .motionActive = false,
+        .lastMotionMs = 0,
+        .motionDetector = NULL,
+        .headless = config->headless,
+        .headlessDetector = NULL,
+        .activeDetector = NULL,
+        .analysisRing = frame_ring_create(ANALYSIS_RING_SLOTS, sizeof(FrameSlot*)),
+        .analysisSkipped = 0,
+        .analysisQueued = 0,
+        .analysisDone = 0,
+        .analysisPool = analysisPool,
+        .analysisSource = -1,
+        .resetDetector = false,
+        .jpegEncoder = NULL,
+        .deltaEncoder = NULL,
+        .keyframeRequested = false,
+        .deltaChain = {},
+        .encodedPool = NULL,
+        .clipRecorder = NULL,
+        .encodeInput = NULL,
+        .encodeReady = {},
+        .pipelineMutex = {},
+        .pipelineCond = {},
+        .idleWakeups = 0,
+        .framesSent = 0
+    };
+    *state = initial;
+    pthread_mutex_init(&state->mutex, NULL);
+    sem_init(&state->encodeReady, 0, 0);
+    pthread_mutex_init(&state->pipelineMutex, NULL);
+    pthread_cond_init(&state->pipelineCond, NULL);
+
+    if (!state->analysisRing)
+    {
+        fprintf(stderr, "Błąd: nie udało się zainicjalizować detektora ruchu\n");
+        return false;
+    }
+
+    // MJPEG: detektor dekoduje samą luminancję w skali 1/4 (1/8 dla 1080p i więcej)
+    MotionParams motionParams = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21,
+        .analysisScale = mjpeg ? (frameWidth >= 1600 ? 8 : 4) : 2,
+        .threads = config->detectorThreads,
+        .input = mjpeg ? MOTION_INPUT_MJPEG : MOTION_INPUT_YUYV
+    };
+
+    // bez klientów: dwukrotnie mniejsza skala analizy i jeden wątek detektora
+    MotionParams headlessParams = motionParams;
+    headlessParams.analysisScale = mjpeg ? 8 : 4;
+    headlessParams.threads = 1;
+
+    // rozmiar klatki MJPEG źródło zna dopiero po negocjacji z kamerą
+    state->framePool = frame_pool_create(FRAME_POOL_SLOTS, state->maxFrameSize, LWS_PRE);
+    state->motionDetector = motion_detector_init(frameWidth, frameHeight, motionParams);
+    if (config->headless)
+        state->headlessDetector = motion_detector_init(frameWidth, frameHeight, headlessParams);
+    GovernorParams governorParams = {
+        .fps = config->fps,
+        .activeStep = ANALYZE_STEP_ACTIVE,
+        .idleStep = ANALYZE_STEP_IDLE,
+        .holdMs = ANALYZE_HOLD_MS,
+        .cpuBudget = config->cpuBudget
+    };
+    state->analysisGovernor = analysis_governor_init(governorParams);
+    state->loggedStep = analysis_governor_step(state->analysisGovernor);
+    if (config->jpegQuality > 0)
+    {
+        state->jpegEncoder = jpeg_encoder_init(frameWidth, frameHeight, config->jpegQuality);
+        // JPEG 4:2:0 mieści się z zapasem w połowie rozmiaru YUYV
+        state->encodedPool = frame_pool_create(ENCODED_POOL_SLOTS, state->maxFrameSize / 2, LWS_PRE);
+    }
+    else if (config->delta)
+    {
+        state->deltaEncoder = tile_delta_init(frameWidth, frameHeight, DELTA_TILE_SIZE,
+                                              DELTA_THRESHOLD, DELTA_KEYFRAME_INTERVAL);
+        // dodatkowe sloty na łańcuch pakietów dla klientów w tyle
+        state->encodedPool = frame_pool_create(ENCODED_POOL_SLOTS + DELTA_CHAIN_SLOTS,
+                                               tile_delta_max_packet_size(frameWidth, frameHeight), LWS_PRE);
+    }
+
+    // klipy z klatek streamu - tylko gdy to JPEG (MJPEG z kamery lub --jpeg)
+    bool clips = config->clipDirectory[0] != '\0';
+    if (clips)
+    {
+        ClipRecorderParams clipParams = {
+            .directory = config->clipDirectory,
+            .width = frameWidth,
+            .height = frameHeight,
+            .fps = STREAM_FPS,
+            .preSeconds = CLIP_PRE_SECONDS,
+            .postSeconds = CLIP_POST_SECONDS,
+            .maxClipSeconds = CLIP_MAX_SECONDS,
+            .memoryLimit = (size_t)config->clipMemoryMb * 1024 * 1024
+        };
+        state->clipRecorder = clip_recorder_init(clipParams);
+    }
+
+    state->analysisSource = analysis_pool_add_source(analysisPool, analysisTask, state);
+
+    if (!state->framePool || !state->motionDetector || (config->headless && !state->headlessDetector) ||
+        !state->analysisGovernor || state->analysisSource < 0 ||
+        (config->jpegQuality > 0 && (!state->jpegEncoder || !state->encodedPool)) ||
+        (config->delta && (!state->deltaEncoder || !state->encodedPool)) ||
+        (clips && !state->clipRecorder))
+    {
+        fprintf(stderr, "Błąd: nie udało się zainicjalizować potoku klatek\n");
+        return false;
+    }
+    fprintf(stderr, "[CAM] Kamera %d: przechwytywanie %s %s %dx%d, stream: %s%s\n", index,
+            capture_source_name(source), mjpeg ? "MJPEG" : "YUYV", frameWidth, frameHeight, streamFormatName(state),
+            config->headless ? ", detekcja bez klientów" : "");
+    return true;
+}
+
+// wątek kodowania (tylko w trybie --jpeg / --delta) i klatki ze źródła
+static bool startCamera(AppState *state)
+{
+    if (state->jpegEncoder || state->deltaEncoder)
+    {
+        if (pthread_create(&state->encodeTid, NULL, encodeThread, state) != 0)
+        {
+            fprintf(stderr, "Błąd: nie udało się uruchomić wątku kodowania\n");
+            return false;
+        }
+        state->encoding = true;
+    }
+
+    if (!capture_source_start(state->source, callbackCapture, state))
+    {
+        fprintf(stderr, "Błąd: nie udało się uruchomić źródła %s\n", capture_source_name(state->source));
+        return false;
+    }
+    state->streaming = true;
+    fprintf(stderr, "[CAM] Kamera %d: stream uruchomiony\n", state->index);
+    return true;
+}
+
+static double perSecond(unsigned long count, double elapsedMs)
+{
+    return elapsedMs > 0 ? count * 1000.0 / elapsedMs : 0.0;
+}
+
+// tempo źródła i to, ile z tego potok faktycznie przetworzył - przy --replay-fps 0
+// źródło czeka na analizę i kodowanie, więc to przepustowość całej usługi
+static void logCaptureStats(AppState *state)
+{
+    CaptureStats stats;
+    capture_source_get_stats(state->source, &stats);
+    fprintf(stderr, "[CAM] Klatki źródła %s: %lu w %.1f s (%.1f/s), odrzucone: %lu, po terminie: %lu\n",
+            capture_source_name(state->source), stats.frames, stats.elapsedMs / 1000.0,
+            perSecond(stats.frames, stats.elapsedMs), stats.rejected, stats.late);
+
+    GovernorStats governor;
+    analysis_governor_get_stats(state->analysisGovernor, &governor);
+    pthread_mutex_lock(&state->mutex);
+    unsigned long published = state->streamSequence;
+    pthread_mutex_unlock(&state->mutex);
+    fprintf(stderr, "[CAM] Potok: przeanalizowane %lu (%.1f/s), opublikowane %lu (%.1f/s), "
+            "wysłane klientom %lu (%.1f/s)\n",
+            governor.updates, perSecond(governor.updates, stats.elapsedMs),
+            published, perSecond(published, stats.elapsedMs),
+            state->framesSent, perSecond(state->framesSent, stats.elapsedMs));
+}
+
+// --replay-fps 0: regulator analizy liczy budżet CPU z faktycznego tempa źródła
+static void updateMeasuredFps(AppState *state)
+{
+    CaptureStats stats;
+    capture_source_get_stats(state->source, &stats);
+    if (stats.elapsedMs >= 1000.0)
+        analysis_governor_set_fps(state->analysisGovernor, perSecond(stats.frames, stats.elapsedMs));
+}
+
+static void logCameraStats(AppState *state)
+{
+    fprintf(stderr, "[CAM] Kamera %d:\n", state->index);
+    logCaptureStats(state);
+    if (state->jpegEncoder)
+    {
+        JpegEncoderStats stats;
+        jpeg_encoder_get_stats(state->jpegEncoder, &stats);
+        logJpegStats(&stats);
+    }
+    if (state->deltaEncoder)
+    {
+        TileDeltaStats stats;
+        tile_delta_get_stats(state->deltaEncoder, &stats);
+        logDeltaStats(&stats);
+    }
+    logFrameDrops(state);
+    logGovernorStats(state);
+    logAnalysisPoolStats(state);
+    if (state->clipRecorder)
+        logClipStats(state);
+}
+
+static void closeCamera(AppState *state)
+{
+    capture_source_destroy(state->source);
+    destroyPipeline(state);
+    pthread_mutex_destroy(&state->mutex);
+}
+
+// zatrzymanie wszystkiego, co zdążyło wystartować: najpierw źródła (koniec nowych
+// klatek), potem analiza i kodowanie, na końcu lws - zamykane przy tym sesje
+// mogą jeszcze zgłaszać reset detektora, który zatrzymana pula ignoruje
+static void shutdownService(ServiceState *service, bool logStats)
+{
+    // źródło może czekać na potok (backpressure) - zatrzymanie je zwalnia
+    stopRequested = true;
+    for (int i = 0; i < service->cameraCount; i++)
+        wakePipeline(&service->cameras[i]);
+    for (int i = 0; i < service->cameraCount; i++)
+    {
+        AppState *state = &service->cameras[i];
+        if (state->streaming)
+        {
+            capture_source_stop(state->source);
+            fprintf(stderr, "[CAM] Kamera %d: stream zatrzymany\n", i);
+        }
+    }
+    analysis_pool_stop(service->analysisPool);
+    for (int i = 0; i < service->cameraCount; i++)
+    {
+        AppState *state = &service->cameras[i];
+        if (state->encoding)
+            stopWorkerThread(&state->encodeReady, state->encodeTid);
+    }
+
+    if (logStats)
+    {
+        unsigned long idleWakeups = 0;
+        for (int i = 0; i < service->cameraCount; i++)
+        {
+            logCameraStats(&service->cameras[i]);
+            idleWakeups += service->cameras[i].idleWakeups;
+        }
+        fprintf(stderr, "[WS] Wybudzenia pętli: %lu, puste SERVER_WRITEABLE: %lu\n",
+                service->serviceWakeups, idleWakeups);
+    }
+
+    if (lwsContext)
+    {
+        lws_context_destroy(lwsContext);
+        lwsContext = NULL;
+    }
+    for (int i = 0; i < service->cameraCount; i++)
+        closeCamera(&service->cameras[i]);
+    analysis_pool_destroy(service->analysisPool);
+    service->analysisPool = NULL;
+}
+
+int main(int argc, char **argv)
 {
     signal(SIGINT, handleSignal);
     signal(SIGTERM, handleSignal);
@@ -237,90 +1390,242 @@ int main(void)
         stderr = logFile;
     }
 
-    MotionParams motionParams = {
-        .motionThreshold = 20,
-        .minArea = 200,
-        .gaussBlur = 21
-    };
+    // --jpeg: stream kodowany do JPEG zamiast surowego YUYV (~15x mniej danych)
+    // --delta: stream różnicowy YUYV - klatka kluczowa + zmienione kafelki (tile_delta.h)
+    // --mjpeg: przechwytywanie MJPEG (wyższe rozdzielczości przy 30 fps), stream bez zmian
+    // --clips: klipy AVI przy ruchu z ostatnich CLIP_PRE_SECONDS s (wymaga streamu JPEG)
+    // --headless: bez klientów kamera pracuje dalej tylko dla detekcji - rzadziej i w mniejszej skali
+    // --camera: kamera o numerze seryjnym (opcjonalnie z własną rozdzielczością), powtarzalne;
+    //           "all" - wszystkie podłączone; bez --camera pierwsza znaleziona
+    // --workers: wątki analizy wspólne dla detektorów wszystkich kamer
+    // --replay: plik lub katalog .yuyv zamiast kamery (powtarzalne, każdy to osobna kamera /camN);
+    //           --replay-fps 0 - bez limitu (pomiar przepustowości), --replay-loops 0 - bez końca
+    int jpegQuality = 0;
+    bool jpegRequested = false;
+    bool delta = false;
+    bool headless = false;
+    const char *clipDirectory = NULL;
+    int clipMemoryMb = CLIP_DEFAULT_MEMORY_MB;
+    bool mjpeg = false;
+    int frameWidth = FRAME_WIDTH;
+    int frameHeight = FRAME_HEIGHT;
+    const char *cameraSpecs[MAX_CAMERAS];
+    int specCount = 0;
+    bool allCameras = false;
+    int workers = ANALYSIS_WORKERS;
+    const char *replaySpecs[MAX_CAMERAS];
+    int replayCount = 0;
+    ReplayOptions replay = {.fps = FPS, .jitterMs = 0, .loops = 0};
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+        if (strcmp(argv[i], "--jpeg") == 0)
+        {
+            jpegRequested = true;
+            jpegQuality = hasValue ? atoi(argv[++i]) : JPEG_DEFAULT_QUALITY;
+        }
+        else if (strcmp(argv[i], "--clips") == 0 && hasValue)
+        {
+            clipDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--clip-memory") == 0 && hasValue)
+        {
+            clipMemoryMb = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--delta") == 0)
+        {
+            delta = true;
+        }
+        else if (strcmp(argv[i], "--mjpeg") == 0)
+        {
+            mjpeg = true;
+            frameWidth = MJPEG_DEFAULT_WIDTH;
+            frameHeight = MJPEG_DEFAULT_HEIGHT;
+            if (hasValue && sscanf(argv[++i], "%dx%d", &frameWidth, &frameHeight) != 2)
+                frameWidth = 0;
+        }
+        else if (strcmp(argv[i], "--camera") == 0 && hasValue && strcmp(argv[i + 1], "all") == 0)
+        {
+            allCameras = true;
+            i++;
+        }
+        else if (strcmp(argv[i], "--camera") == 0 && hasValue && specCount < MAX_CAMERAS)
+        {
+            cameraSpecs[specCount++] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--workers") == 0 && hasValue)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && hasValue && replayCount < MAX_CAMERAS)
+        {
+            replaySpecs[replayCount++] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay-fps") == 0 && hasValue)
+        {
+            replay.fps = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replay-jitter") == 0 && hasValue)
+        {
+            replay.jitterMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replay-loops") == 0 && hasValue)
+        {
+            replay.loops = atoi(argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((jpegRequested && (jpegQuality < 1 || jpegQuality > 100)) || (jpegRequested && delta) ||
+        frameWidth < 64 || frameHeight < 64 || frameWidth % 8 || frameHeight % 8 || clipMemoryMb < 1 ||
+        workers < 1 || (allCameras && specCount > 0) ||
+        (replayCount > 0 && (specCount > 0 || allCameras || mjpeg)) ||
+        replay.fps < 0 || replay.jitterMs < 0 || replay.loops < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (mjpeg && jpegRequested)
+    {
+        fprintf(stderr, "[CAM] --jpeg pominięte - kamera już dostarcza JPEG\n");
+        jpegQuality = 0;
+    }
+    if (mjpeg && delta)
+    {
+        fprintf(stderr, "[CAM] --delta pominięte - kamera już dostarcza JPEG\n");
+        delta = false;
+    }
+    if (clipDirectory && !mjpeg && jpegQuality == 0)
+    {
+        fprintf(stderr, "[CLIP] --clips pominięte - wymaga --jpeg lub --mjpeg\n");
+        clipDirectory = NULL;
+    }
 
-    struct timespec timeNow;
-    clock_gettime(CLOCK_MONOTONIC, &timeNow);
-
-    // inicjalizacja zmiennych dla state
-    AppState state = {
-        .connectionEstablished = false,
-        .lastJsonSentTime = timeNow,
-        .lastFrameSentTime = timeNow,
-        .frameBuffer = {0},
-        .frameSize = 0,
-        .prevFrameBuffer = {0},
-        .prevFrameSize = 0,
-        .hasNewFrame = 0,
-        .frameCounter = 0,
-        .motionDetectedFlag = false,
-        .motionDetector = motion_detector_init(640, 480, motionParams)
+    CameraConfig defaults = {
+        .source = "",
+        .mjpeg = mjpeg,
+        .frameWidth = frameWidth,
+        .frameHeight = frameHeight,
+        .jpegQuality = jpegQuality,
+        .delta = delta,
+        .headless = headless,
+        .clipDirectory = "",
+        .clipMemoryMb = clipMemoryMb,
+        .detectorThreads = 2,
+        .cpuBudget = ANALYSIS_CPU_BUDGET,
+        .fps = replayCount > 0 && replay.fps >= 1.0 ? (int)(replay.fps + 0.5) : FPS,
+        .backpressure = replayCount > 0 && replay.fps == 0
     };
-    pthread_mutex_init(&state.mutex, NULL);
+    CameraConfig configs[MAX_CAMERAS];
+    const char **specs = replayCount > 0 ? replaySpecs : cameraSpecs;
+    int specTotal = replayCount > 0 ? replayCount : specCount;
+    int configCount = specTotal > 0 ? specTotal : 1;
+    for (int i = 0; i < MAX_CAMERAS; i++)
+        configs[i] = defaults;
 
-    if (!state.motionDetector)
+    // NUMER_SERYJNY@SZERxWYS / ŚCIEŻKA@SZERxWYS - rozdzielczość tylko tej kamery
+    for (int i = 0; i < specTotal; i++)
     {
-        fprintf(stderr, "Błąd: nie udało się zainicjalizować detektora ruchu\n");
-        return 1;
+        const char *size = strrchr(specs[i], '@');
+        size_t sourceLength = size ? (size_t)(size - specs[i]) : strlen(specs[i]);
+        if (sourceLength == 0 || sourceLength >= sizeof(configs[i].source) ||
+            (size && !parseFrameSize(size + 1, &configs[i].frameWidth, &configs[i].frameHeight)))
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        memcpy(configs[i].source, specs[i], sourceLength);
+        configs[i].source[sourceLength] = '\0';
     }
 
-    // zmienne kamery UVC
-    uvc_context_t *camContext;
-    uvc_device_t *device;
-    uvc_device_handle_t *devHandler = NULL;
-    uvc_stream_ctrl_t streamCtrl;
-    uvc_error_t res;
-
-     // Inicjalizacja UVC
-    res = uvc_init(&camContext, NULL);
-    if (res < 0)
+    // źródła klatek: pliki --replay (bez libuvc) albo kamery UVC
+    CaptureSource *sources[MAX_CAMERAS];
+    uvc_context_t *camContext = NULL;
+    int cameraCount;
+    if (replayCount > 0)
     {
-        uvc_perror(res, "uvc_init");
-        motion_detector_destroy(state.motionDetector);
+        cameraCount = openReplaySources(configs, replayCount, &replay, sources);
+        if (!headless && !clipDirectory)
+            fprintf(stderr, "[REPLAY] Bez klientów klatki są pomijane - --headless analizuje je także bez klientów\n");
+    }
+    else
+    {
+        uvc_error_t res = uvc_init(&camContext, NULL);
+        if (res < 0)
+        {
+            uvc_perror(res, "uvc_init");
+            return 1;
+        }
+        cameraCount = openCameraSources(camContext, configs, configCount, allCameras, sources);
+    }
+    if (cameraCount == 0)
+    {
+        if (camContext)
+            uvc_exit(camContext);
         return 1;
     }
 
-    res = uvc_find_device(camContext, &device, 0, 0, NULL);
-    if (res < 0)
+    // kilka kamer: jeden wątek detektora na kamerę (równoległość z puli analizy),
+    // budżet CPU analizy dzielony równo, klipy w osobnych podkatalogach
+    for (int i = 0; i < cameraCount; i++)
     {
-        uvc_perror(res, "find_device");
-        motion_detector_destroy(state.motionDetector);
-        uvc_exit(camContext);
-        return 1;
+        CameraConfig *config = &configs[i];
+        if (cameraCount > 1)
+        {
+            config->detectorThreads = 1;
+            double share = (double)workers / cameraCount;
+            if (share < config->cpuBudget)
+                config->cpuBudget = share;
+        }
+        if (clipDirectory && cameraCount > 1)
+        {
+            snprintf(config->clipDirectory, sizeof(config->clipDirectory), "%s/cam%d", clipDirectory, i);
+            if (mkdir(config->clipDirectory, 0755) != 0 && errno != EEXIST)
+                fprintf(stderr, "[CLIP] Nie można utworzyć %s: %s\n", config->clipDirectory, strerror(errno));
+        }
+        else if (clipDirectory)
+        {
+            snprintf(config->clipDirectory, sizeof(config->clipDirectory), "%s", clipDirectory);
+        }
     }
 
-    res = uvc_open(device, &devHandler);
-    if (res < 0)
+    ServiceState service = {};
+    service.analysisPool = analysis_pool_create(workers, MAX_CAMERAS);
+    if (!service.analysisPool)
     {
-        uvc_perror(res, "uvc_open");
-        uvc_unref_device(device);
-        uvc_exit(camContext);
-        motion_detector_destroy(state.motionDetector);
+        fprintf(stderr, "Błąd: nie udało się uruchomić puli analizy\n");
+        for (int i = 0; i < cameraCount; i++)
+            capture_source_destroy(sources[i]);
+        if (camContext)
+            uvc_exit(camContext);
         return 1;
     }
 
-    usleep(300000); // 300ms delay
-
-    res = uvc_get_stream_ctrl_format_size(devHandler, &streamCtrl,
-                                          UVC_FRAME_FORMAT_YUYV, 640, 480, FPS);
-    if (res < 0)
+    for (int i = 0; i < cameraCount; i++)
     {
-        uvc_perror(res, "get_stream_ctrl");
-        uvc_close(devHandler);
-        uvc_unref_device(device);
-        uvc_exit(camContext);
-        motion_detector_destroy(state.motionDetector);
-        return 1;
+        service.cameraCount++;
+        if (!initCamera(&service.cameras[i], i, sources[i], &configs[i], service.analysisPool))
+        {
+            for (int j = i + 1; j < cameraCount; j++)
+                capture_source_destroy(sources[j]);
+            shutdownService(&service, false);
+            if (camContext)
+                uvc_exit(camContext);
+            return 1;
+        }
     }
 
-    // protokół WebSocket
+    // protokół WebSocket - kamera wybierana ścieżką /camN
     struct lws_protocols protocols[] =
     {
-        { "cam-protocol", callbackWs, 0, MAX_FRAME_SIZE, 0, NULL, 0},
+        { "cam-protocol", callbackWs, sizeof(ClientSession), MAX_FRAME_SIZE, 0, NULL, 0},
         { NULL, NULL, 0, 0, 0, NULL, 0 }
     };
 
@@ -328,54 +1633,56 @@ int main(void)
     memset(&info, 0, sizeof info);
     info.port = PORT;
     info.protocols = protocols;
-    info.user = &state;
+    info.user = &service;
 
      // tworzenie kontekstu WebSocket
     lwsContext = lws_create_context(&info);
     if (!lwsContext)
     {
         fprintf(stderr, "Błąd: nie udało się utworzyć kontekstu WebSocket\n");
-        uvc_close(devHandler);
-        uvc_unref_device(device);
-        uvc_exit(camContext);
-        motion_detector_destroy(state.motionDetector);
+        shutdownService(&service, false);
+        if (camContext)
+            uvc_exit(camContext);
         return 1;
     }
 
-    fprintf(stderr, "Serwer WebSocket działa na ws://<IP>:%d\n", PORT);
+    fprintf(stderr, "Serwer WebSocket działa na ws://<IP>:%d (kamery: /cam0 - /cam%d)\n",
+            PORT, cameraCount - 1);
 
-    // start streamu z kamery
-    usleep(100000); // 100ms delay
-    res = uvc_start_streaming(devHandler, &streamCtrl, callbackUVC, &state, 0);
-    if (res < 0)
+    // pula analizy działa od początku - źródła dopiero teraz zaczynają ją zasilać
+    for (int i = 0; i < cameraCount; i++)
     {
-        uvc_perror(res, "[CAM] Błąd uruchomienia streamu");
-        lws_context_destroy(lwsContext);
-        uvc_close(devHandler);
-        uvc_unref_device(device);
-        uvc_exit(camContext);
-        motion_detector_destroy(state.motionDetector);
-        return 1;
+        if (!startCamera(&service.cameras[i]))
+        {
+            shutdownService(&service, false);
+            if (camContext)
+                uvc_exit(camContext);
+            return 1;
+        }
     }
-    fprintf(stderr, "[CAM] Stream uruchomiony\n");
 
     // główna pętla dla obsługi WebSocket
+    // pętla bez stałych opóźnień - śpi do zdarzenia sieciowego, timera
+    // albo lws_cancel_service (nowa klatka, sygnał zatrzymania)
     while (!stopRequested)
     {
         lws_service(lwsContext, LWS_TIMEOUT);
-        usleep(MIN_INTERVAL * 1000);
+        service.serviceWakeups++;
+        for (int i = 0; i < cameraCount; i++)
+        {
+            if (service.cameras[i].backpressure)
+                updateMeasuredFps(&service.cameras[i]);
+        }
+        // skończone odtwarzanie - zamknięcie ze statystykami przepustowości w logu
+        if (replayCount > 0 && sourcesFinished(&service))
+            stopRequested = true;
     }
 
     // Cleanup
     fprintf(stderr, "[SHUTDOWN] Rozpoczęcie zamykania programu...\n");
-    uvc_stop_streaming(devHandler);
-    fprintf(stderr, "[CAM] Stream zatrzymany\n");
-    uvc_close(devHandler);
-    uvc_unref_device(device);
-    uvc_exit(camContext);
-    lws_context_destroy(lwsContext);
-    motion_detector_destroy(state.motionDetector);
-    pthread_mutex_destroy(&state.mutex);
+    shutdownService(&service, true);
+    if (camContext)
+        uvc_exit(camContext);
 
     if (logFile)
     {
@@ -383,4 +1690,4 @@ int main(void)
     }
 
     return 0;
-}
\ No newline at end of file
+}
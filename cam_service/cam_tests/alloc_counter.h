@@ -0,0 +1,78 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <errno.h>
+#include <stddef.h>
+
+// Licznik alokacji dla testów i benchmarków: podmiana malloc i spółki w pliku
+// wykonywalnym liczy też alokacje wewnątrz OpenCV i libstdc++ (glibc udostępnia
+// oryginały jako __libc_*). Definiuje funkcje - dołączać w jednym pliku .c
+// programu. Bez glibc COUNT_ALLOCS nie jest zdefiniowane, a allocsNow() zwraca 0.
+
+#ifdef __GLIBC__
+#define COUNT_ALLOCS 1
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+static unsigned long allocCount = 0;
+
+static inline void countAlloc(void)
+{
+    __atomic_fetch_add(&allocCount, 1, __ATOMIC_RELAXED);
+}
+
+void* malloc(size_t size)
+{
+    countAlloc();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    countAlloc();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    countAlloc();
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    countAlloc();
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    countAlloc();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size)
+{
+    countAlloc();
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr)
+        return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+static unsigned long allocsNow(void)
+{
+    return __atomic_load_n(&allocCount, __ATOMIC_RELAXED);
+}
+#else
+static unsigned long allocsNow(void)
+{
+    return 0;
+}
+#endif
+
+#endif // ALLOC_COUNTER_H
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../motion_detector.h"
+
+// Porównanie GaussianBlur z rozmyciem boxem: czas detekcji i zgodność wyników
+// na parach klatek z images/*.yuyv
+
+#define WIDTH 640
+#define HEIGHT 480
+#define ITERATIONS 200
+
+typedef struct {
+    unsigned char* data;
+    size_t size;
+} ImageBuffer;
+
+typedef struct {
+    const char* current;
+    const char* prev;
+} FramePair;
+
+typedef struct {
+    const char* name;
+    MotionParams params;
+} ParamSet;
+
+static ImageBuffer load_yuyv_file(const char* filename)
+{
+    ImageBuffer img = {NULL, 0};
+    FILE* f = fopen(filename, "rb");
+
+    if (!f)
+    {
+        fprintf(stderr, "Nie można otworzyć: %s\n", filename);
+        return img;
+    }
+
+    fseek(f, 0, SEEK_END);
+    img.size = ftell(f);
+    rewind(f);
+
+    img.data = malloc(img.size);
+    if (img.data && fread(img.data, 1, img.size, f) != img.size)
+    {
+        free(img.data);
+        img.data = NULL;
+        img.size = 0;
+    }
+
+    fclose(f);
+    return img;
+}
+
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// średni czas jednego wywołania motion_detector_detect [ms]
+static double timeDetect(void* detector, const ImageBuffer* cur, const ImageBuffer* prev, bool* result)
+{
+    *result = motion_detector_detect(detector, cur->data, cur->size, prev->data, prev->size);
+
+    double start = nowMs();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        motion_detector_detect(detector, cur->data, cur->size, prev->data, prev->size);
+    }
+    return (nowMs() - start) / ITERATIONS;
+}
+
+int main(void)
+{
+    const FramePair pairs[] = {
+        {"images/move_2.yuyv", "images/move_1.yuyv"},
+        {"images/finger5.yuyv", "images/finger4.yuyv"},
+        {"images/move_1.yuyv", "images/move_1.yuyv"},
+        {"images/finger4.yuyv", "images/finger4.yuyv"},
+    };
+
+    const ParamSet paramSets[] = {
+        {"sensitive", {.motionThreshold = 5, .minArea = 50, .gaussBlur = 21}},
+        {"base", {.motionThreshold = 20, .minArea = 200, .gaussBlur = 21}},
+        {"insensitive", {.motionThreshold = 50, .minArea = 500, .gaussBlur = 21}},
+        {"base/2", {.motionThreshold = 20, .minArea = 200, .gaussBlur = 21, .analysisScale = 2}},
+        {"base/4", {.motionThreshold = 20, .minArea = 200, .gaussBlur = 21, .analysisScale = 4}},
+    };
+
+    const size_t pairCount = sizeof(pairs) / sizeof(pairs[0]);
+    const size_t setCount = sizeof(paramSets) / sizeof(paramSets[0]);
+
+    double gaussTotal = 0.0;
+    double boxTotal = 0.0;
+    int agree = 0;
+    int cases = 0;
+
+    printf("%-24s %-12s %10s %10s %6s %6s\n", "para", "parametry", "gauss[ms]", "box[ms]", "gauss", "box");
+
+    for (size_t p = 0; p < pairCount; p++)
+    {
+        ImageBuffer cur = load_yuyv_file(pairs[p].current);
+        ImageBuffer prev = load_yuyv_file(pairs[p].prev);
+        if (!cur.data || !prev.data)
+        {
+            free(cur.data);
+            free(prev.data);
+            return 1;
+        }
+
+        for (size_t s = 0; s < setCount; s++)
+        {
+            MotionParams gaussParams = paramSets[s].params;
+            MotionParams boxParams = paramSets[s].params;
+            gaussParams.blur = MOTION_BLUR_GAUSSIAN;
+            boxParams.blur = MOTION_BLUR_BOX;
+
+            void* gaussDetector = motion_detector_init(WIDTH, HEIGHT, gaussParams);
+            void* boxDetector = motion_detector_init(WIDTH, HEIGHT, boxParams);
+            if (!gaussDetector || !boxDetector)
+            {
+                return 1;
+            }
+
+            bool gaussResult, boxResult;
+            double gaussMs = timeDetect(gaussDetector, &cur, &prev, &gaussResult);
+            double boxMs = timeDetect(boxDetector, &cur, &prev, &boxResult);
+
+            gaussTotal += gaussMs;
+            boxTotal += boxMs;
+            agree += gaussResult == boxResult;
+            cases++;
+
+            char pairName[64];
+            snprintf(pairName, sizeof(pairName), "%s<-%s",
+                     strrchr(pairs[p].current, '/') + 1, strrchr(pairs[p].prev, '/') + 1);
+            printf("%-24s %-12s %10.3f %10.3f %6s %6s%s\n", pairName, paramSets[s].name,
+                   gaussMs, boxMs, gaussResult ? "ruch" : "-", boxResult ? "ruch" : "-",
+                   gaussResult == boxResult ? "" : "  <- RÓŻNICA");
+
+            motion_detector_destroy(gaussDetector);
+            motion_detector_destroy(boxDetector);
+        }
+
+        free(cur.data);
+        free(prev.data);
+    }
+
+    printf("\nśrednio: gauss %.3f ms, box %.3f ms (x%.2f), zgodność %d/%d\n",
+           gaussTotal / cases, boxTotal / cases, boxTotal > 0 ? gaussTotal / boxTotal : 0.0,
+           agree, cases);
+
+    return agree == cases ? 0 : 2;
+}
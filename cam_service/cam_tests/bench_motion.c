@@ -0,0 +1,351 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../motion_detector.h"
+#include "../yuyv_luma.h"
+#include "alloc_counter.h"
+
+// Benchmark detektora ruchu: przepuszcza klatki z images/*.yuyv i sekwencje
+// syntetyczne przez motion_detector_push_frame, mierzy czasy etapów, FPS,
+// opóźnienia p50/p99 i alokacje na wywołanie. --json dla śledzenia regresji.
+//
+// ./bench_motion [--iterations N] [--threads N] [--scale 1|2|4]
+//                [--blur gauss|box] [--mode diff|bg] [--json]
+
+#define WIDTH 640
+#define HEIGHT 480
+#define FRAME_SIZE (WIDTH * HEIGHT * 2)
+#define MAX_FIXTURES 32
+#define SYNTH_FRAMES 16
+
+// flagi optymalizacji z makefile (BENCH_OPT) - do nagłówka wyników
+#ifndef BENCH_OPT
+#define BENCH_OPT ""
+#endif
+
+// ============ KLATKI ============
+
+typedef struct {
+    const char* name;
+    unsigned char** frames;
+    int frameCount;
+} Scenario;
+
+typedef struct {
+    const char* name;
+    int frames;
+    double fps;
+    double meanMs;
+    double p50Ms;
+    double p99Ms;
+    double maxMs;
+    double allocsPerCall;
+    size_t detectorAllocs;
+    double motionRatio;
+    MotionStageTimes stages;
+} ScenarioResult;
+
+static int compareNames(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static unsigned char* loadFrame(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    unsigned char* data = malloc(FRAME_SIZE);
+    if (data && fread(data, 1, FRAME_SIZE, f) != FRAME_SIZE)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+// wszystkie images/*.yuyv w kolejności alfabetycznej
+static int loadFixtures(unsigned char** frames, int maxFrames)
+{
+    DIR* dir = opendir("images");
+    if (!dir)
+    {
+        fprintf(stderr, "Nie można otworzyć katalogu images\n");
+        return 0;
+    }
+
+    char* names[MAX_FIXTURES];
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) && count < maxFrames)
+    {
+        size_t len = strlen(entry->d_name);
+        if (len > 5 && strcmp(entry->d_name + len - 5, ".yuyv") == 0)
+        {
+            names[count++] = strdup(entry->d_name);
+        }
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(names[0]), compareNames);
+
+    int loaded = 0;
+    for (int i = 0; i < count; i++)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), "images/%s", names[i]);
+        unsigned char* frame = loadFrame(path);
+        if (frame)
+            frames[loaded++] = frame;
+        else
+            fprintf(stderr, "Pominięto %s (zły rozmiar)\n", path);
+        free(names[i]);
+    }
+    return loaded;
+}
+
+// deterministyczny szum dla syntetycznych klatek
+static unsigned int lcg(unsigned int* seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 16) & 0x7fff;
+}
+
+// tło: gradient + szum czujnika; opcjonalnie jasny kwadrat 64x64 w (sx, sy)
+static unsigned char* synthFrame(unsigned int seed, int sx, int sy)
+{
+    unsigned char* frame = malloc(FRAME_SIZE);
+    if (!frame)
+        return NULL;
+
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < WIDTH; x++)
+        {
+            int luma = 60 + (x + y) / 10 + (int)(lcg(&seed) % 5);
+            if (sx >= 0 && x >= sx && x < sx + 64 && y >= sy && y < sy + 64)
+                luma = 220;
+            unsigned char* px = frame + (y * WIDTH + x) * 2;
+            px[0] = (unsigned char)luma;
+            px[1] = 128;
+        }
+    }
+    return frame;
+}
+
+// ============ POMIAR ============
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool runScenario(const Scenario* scenario, MotionParams params, int iterations,
+                        double* latencies, ScenarioResult* out)
+{
+    void* detector = motion_detector_init(WIDTH, HEIGHT, params);
+    if (!detector)
+        return false;
+
+    // rozgrzewka - pierwsza klatka, cache, wątki puli
+    for (int i = 0; i < scenario->frameCount; i++)
+    {
+        motion_detector_push_frame(detector, scenario->frames[i], FRAME_SIZE);
+    }
+    motion_detector_set_profiling(detector, true);
+    motion_detector_reset_stage_times(detector);
+    size_t detectorAllocsBefore = motion_detector_alloc_count(detector);
+
+    int motionCount = 0;
+    unsigned long allocsBefore = allocsNow();
+    double start = nowMs();
+    for (int i = 0; i < iterations; i++)
+    {
+        const unsigned char* frame = scenario->frames[i % scenario->frameCount];
+        double t0 = nowMs();
+        motionCount += motion_detector_push_frame(detector, frame, FRAME_SIZE);
+        latencies[i] = nowMs() - t0;
+    }
+    double total = nowMs() - start;
+    unsigned long allocs = allocsNow() - allocsBefore;
+
+    memset(out, 0, sizeof(*out));
+    out->name = scenario->name;
+    out->frames = scenario->frameCount;
+    out->fps = total > 0 ? iterations * 1000.0 / total : 0.0;
+    out->meanMs = total / iterations;
+    out->allocsPerCall = (double)allocs / iterations;
+    out->detectorAllocs = motion_detector_alloc_count(detector) - detectorAllocsBefore;
+    out->motionRatio = (double)motionCount / iterations;
+    motion_detector_get_stage_times(detector, &out->stages);
+
+    qsort(latencies, iterations, sizeof(double), compareDoubles);
+    out->p50Ms = latencies[iterations / 2];
+    out->p99Ms = latencies[(int)(iterations * 0.99)];
+    out->maxMs = latencies[iterations - 1];
+
+    motion_detector_destroy(detector);
+    return true;
+}
+
+static void printText(const ScenarioResult* r, int iterations)
+{
+    double n = r->stages.calls ? (double)r->stages.calls : 1.0;
+    printf("%-16s klatek %2d  %8.1f fps  śr %.3f ms  p50 %.3f ms  p99 %.3f ms  max %.3f ms  ruch %3.0f%%\n",
+           r->name, r->frames, r->fps, r->meanMs, r->p50Ms, r->p99Ms, r->maxMs, r->motionRatio * 100.0);
+    printf("%-16s etapy [ms/klatkę]: luma %.3f  blur %.3f  diff %.3f  threshold %.3f  dilate %.3f  blobs %.3f\n",
+           "", r->stages.lumaMs / n, r->stages.blurMs / n, r->stages.diffMs / n,
+           r->stages.thresholdMs / n, r->stages.dilateMs / n, r->stages.blobsMs / n);
+    printf("%-16s alokacje/wywołanie %.2f (bufory detektora: %zu na %d wywołań)\n",
+           "", r->allocsPerCall, r->detectorAllocs, iterations);
+}
+
+static void printJson(const ScenarioResult* r, bool last)
+{
+    double n = r->stages.calls ? (double)r->stages.calls : 1.0;
+    printf("    {\"name\": \"%s\", \"frames\": %d, \"fps\": %.2f, "
+           "\"latency_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f}, "
+           "\"stages_ms\": {\"luma\": %.4f, \"blur\": %.4f, \"diff\": %.4f, \"threshold\": %.4f, "
+           "\"dilate\": %.4f, \"blobs\": %.4f}, "
+           "\"allocs_per_call\": %.3f, \"detector_allocs\": %zu, \"motion_ratio\": %.3f}%s\n",
+           r->name, r->frames, r->fps, r->meanMs, r->p50Ms, r->p99Ms, r->maxMs,
+           r->stages.lumaMs / n, r->stages.blurMs / n, r->stages.diffMs / n,
+           r->stages.thresholdMs / n, r->stages.dilateMs / n, r->stages.blobsMs / n,
+           r->allocsPerCall, r->detectorAllocs, r->motionRatio, last ? "" : ",");
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Użycie: %s [--iterations N] [--threads N] [--scale 1|2|4] "
+                    "[--blur gauss|box] [--mode diff|bg] [--json]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = 2000;
+    bool json = false;
+    MotionParams params = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+            iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            params.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--scale") == 0 && hasValue)
+            params.analysisScale = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--blur") == 0 && hasValue)
+            params.blur = strcmp(argv[++i], "box") == 0 ? MOTION_BLUR_BOX : MOTION_BLUR_GAUSSIAN;
+        else if (strcmp(argv[i], "--mode") == 0 && hasValue)
+            params.mode = strcmp(argv[++i], "bg") == 0 ? MOTION_MODE_BACKGROUND : MOTION_MODE_FRAME_DIFF;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (iterations < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // klatki: fixture'y, statyczna scena i przesuwający się kwadrat
+    unsigned char* fixtures[MAX_FIXTURES];
+    int fixtureCount = loadFixtures(fixtures, MAX_FIXTURES);
+    if (fixtureCount == 0)
+        return 1;
+
+    unsigned char* staticFrames[1] = { synthFrame(1, -1, -1) };
+    unsigned char* movingFrames[SYNTH_FRAMES];
+    for (int i = 0; i < SYNTH_FRAMES; i++)
+    {
+        movingFrames[i] = synthFrame(1 + i, 40 + i * 32, 120 + i * 12);
+        if (!movingFrames[i])
+            return 1;
+    }
+    if (!staticFrames[0])
+        return 1;
+
+    const Scenario scenarios[] = {
+        {"fixtures", fixtures, fixtureCount},
+        {"synth_static", staticFrames, 1},
+        {"synth_moving", movingFrames, SYNTH_FRAMES},
+    };
+    const int scenarioCount = sizeof(scenarios) / sizeof(scenarios[0]);
+
+    double* latencies = malloc(sizeof(double) * iterations);
+    ScenarioResult results[sizeof(scenarios) / sizeof(scenarios[0])];
+    if (!latencies)
+        return 1;
+
+    for (int i = 0; i < scenarioCount; i++)
+    {
+        if (!runScenario(&scenarios[i], params, iterations, latencies, &results[i]))
+        {
+            fprintf(stderr, "Błąd inicjalizacji detektora\n");
+            return 1;
+        }
+    }
+
+    YuyvLumaIsa isa = YUYV_LUMA_SCALAR;
+    yuyv_luma_select(params.analysisScale > 0 ? params.analysisScale : 1, &isa);
+    const char* blurName = params.blur == MOTION_BLUR_BOX ? "box" : "gauss";
+    const char* modeName = params.mode == MOTION_MODE_BACKGROUND ? "bg" : "diff";
+
+    if (json)
+    {
+        printf("{\n  \"config\": {\"iterations\": %d, \"threads\": %d, \"scale\": %d, \"blur\": \"%s\", "
+               "\"mode\": \"%s\", \"luma\": \"%s\", \"count_allocs\": %s, "
+               "\"compiler\": \"%s\", \"flags\": \"%s\"},\n  \"scenarios\": [\n",
+               iterations, params.threads > 0 ? params.threads : 1,
+               params.analysisScale > 0 ? params.analysisScale : 1, blurName, modeName,
+               yuyv_luma_isa_name(isa),
+#ifdef COUNT_ALLOCS
+               "true"
+#else
+               "false"
+#endif
+               , __VERSION__, BENCH_OPT);
+        for (int i = 0; i < scenarioCount; i++)
+            printJson(&results[i], i == scenarioCount - 1);
+        printf("  ]\n}\n");
+    }
+    else
+    {
+        printf("iteracje %d, wątki %d, skala %d, blur %s, tryb %s, luma %s, flagi \"%s\"\n\n",
+               iterations, params.threads > 0 ? params.threads : 1,
+               params.analysisScale > 0 ? params.analysisScale : 1, blurName, modeName,
+               yuyv_luma_isa_name(isa), BENCH_OPT);
+        for (int i = 0; i < scenarioCount; i++)
+            printText(&results[i], iterations);
+    }
+
+    free(latencies);
+    for (int i = 0; i < fixtureCount; i++)
+        free(fixtures[i]);
+    free(staticFrames[0]);
+    for (int i = 0; i < SYNTH_FRAMES; i++)
+        free(movingFrames[i]);
+
+    return 0;
+}
@@ -5,7 +5,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #include "../motion_detector.h"
+#include "../yuyv_luma.h"
+#include "../box_blur.h"
+#include "../frame_ring.h"
+#include "../frame_pool.h"
+#include "../jpeg_encoder.h"
+#include "../tile_delta.h"
+#include "../clip_recorder.h"
+#include "../analysis_governor.h"
+#include "../analysis_pool.h"
+#include "../replay_source.h"
+#include "alloc_counter.h"
 
 typedef struct {
     unsigned char* data;
@@ -305,9 +319,1263 @@ static void test_motion_parameters_small_movment(void **state)
     free_image_buffer(&img2);
 }
 
+// Test 8: Strumieniowe API - każda klatka podawana raz
+static void test_push_frame_stream(void **state) {
+    void* detector = *state;
+
+    ImageBuffer imgA = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+
+    // pierwsza klatka - brak poprzedniej = brak ruchu
+    assert_false(motion_detector_push_frame(detector, imgA.data, imgA.size));
+
+    // A -> A (brak ruchu)
+    assert_false(motion_detector_push_frame(detector, imgA.data, imgA.size));
+
+    // A -> B (ruch)
+    assert_true(motion_detector_push_frame(detector, imgB.data, imgB.size));
+
+    // B -> A (ruch)
+    assert_true(motion_detector_push_frame(detector, imgA.data, imgA.size));
+
+    // po resecie pierwsza klatka znów nie daje ruchu
+    motion_detector_reset(detector);
+    assert_false(motion_detector_push_frame(detector, imgB.data, imgB.size));
+
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
+// Test 9: Strumieniowe API daje te same wyniki co porównanie dwóch buforów
+static void test_push_frame_matches_detect(void **state) {
+    void* detector = *state;
+
+    ImageBuffer img1 = load_yuyv_file("images/finger4.yuyv");
+    ImageBuffer img2 = load_yuyv_file("images/finger5.yuyv");
+
+    assert_non_null(img1.data);
+    assert_non_null(img2.data);
+
+    bool expected = motion_detector_detect(detector,
+        img2.data, img2.size, img1.data, img1.size);
+
+    motion_detector_push_frame(detector, img1.data, img1.size);
+    bool streamed = motion_detector_push_frame(detector, img2.data, img2.size);
+    assert_int_equal(expected, streamed);
+
+    // zły rozmiar klatki
+    assert_false(motion_detector_push_frame(detector, img1.data, img1.size / 2));
+
+    free_image_buffer(&img1);
+    free_image_buffer(&img2);
+}
+
+
+// Test 10: Wszystkie dostępne warianty SIMD dają to samo co wersja skalarna
+static void test_luma_variants_match_scalar(void **state) {
+    (void)state;
+
+    ImageBuffer img = load_yuyv_file("images/finger4.yuyv");
+    assert_non_null(img.data);
+
+    const int decimations[] = {1, 2, 4};
+    for (size_t i = 0; i < sizeof(decimations) / sizeof(decimations[0]); i++)
+    {
+        int dec = decimations[i];
+        size_t outSize = (size_t)(640 / dec) * (480 / dec);
+        unsigned char* expected = malloc(outSize);
+        unsigned char* actual = malloc(outSize);
+        assert_non_null(expected);
+        assert_non_null(actual);
+
+        YuyvLumaFn scalar = yuyv_luma_get(YUYV_LUMA_SCALAR, dec);
+        assert_non_null(scalar);
+        scalar(img.data, 640 * 2, expected, 640 / dec, 640, 480);
+
+        for (int isa = YUYV_LUMA_SCALAR + 1; isa < YUYV_LUMA_ISA_COUNT; isa++)
+        {
+            YuyvLumaFn fn = yuyv_luma_get((YuyvLumaIsa)isa, dec);
+            if (!fn)
+                continue;
+            memset(actual, 0, outSize);
+            fn(img.data, 640 * 2, actual, 640 / dec, 640, 480);
+            assert_memory_equal(expected, actual, outSize);
+        }
+
+        // bez decymacji Y to co drugi bajt
+        if (dec == 1)
+        {
+            assert_int_equal(expected[0], img.data[0]);
+            assert_int_equal(expected[1], img.data[2]);
+        }
+
+        free(expected);
+        free(actual);
+    }
+
+    // nieobsługiwana decymacja
+    assert_null(yuyv_luma_select(3, NULL));
+
+    free_image_buffer(&img);
+}
+
+// Test 11: Analiza na pomniejszonym obrazie (320x240 i 160x120)
+static void test_downscaled_analysis(void **state) {
+    (void)state;
+
+    ImageBuffer img1 = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer img2 = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(img1.data);
+    assert_non_null(img2.data);
+
+    const int scales[] = {2, 4};
+    for (size_t i = 0; i < sizeof(scales) / sizeof(scales[0]); i++)
+    {
+        MotionParams params = {
+            .motionThreshold = 20,
+            .minArea = 200,
+            .gaussBlur = 21,
+            .analysisScale = scales[i]
+        };
+
+        void* detector = motion_detector_init(640, 480, params);
+        assert_non_null(detector);
+
+        // ten sam obraz - brak ruchu
+        assert_false(motion_detector_detect(detector,
+            img1.data, img1.size, img1.data, img1.size));
+
+        // duży ruch widoczny także po pomniejszeniu
+        assert_true(motion_detector_detect(detector,
+            img2.data, img2.size, img1.data, img1.size));
+
+        motion_detector_destroy(detector);
+    }
+
+    // nieobsługiwana skala
+    MotionParams invalid = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21,
+        .analysisScale = 3
+    };
+    assert_null(motion_detector_init(640, 480, invalid));
+
+    free_image_buffer(&img1);
+    free_image_buffer(&img2);
+}
+
+// Test 12: W stanie ustalonym push_frame nie alokuje pamięci - licznik malloc
+// obejmuje też alokacje wewnątrz OpenCV i libstdc++ (Gauss, box, tło, wątki)
+static void steady_state_allocs(void* detector, const ImageBuffer* imgA, const ImageBuffer* imgB)
+{
+    // rozgrzewka: pierwsze klatki, reset i pełny wynik z ramkami
+    MotionResult result;
+    for (int i = 0; i < 4; i++)
+    {
+        const ImageBuffer* img = (i % 2) ? imgB : imgA;
+        motion_detector_push_frame_ex(detector, img->data, img->size, &result);
+    }
+    motion_detector_reset(detector);
+    motion_detector_push_frame(detector, imgA->data, imgA->size);
+
+    unsigned long before = allocsNow();
+    for (int i = 0; i < 20; i++)
+    {
+        const ImageBuffer* img = (i % 2) ? imgB : imgA;
+        motion_detector_push_frame(detector, img->data, img->size);
+        motion_detector_push_frame_ex(detector, img->data, img->size, &result);
+    }
+    motion_detector_reset(detector);
+    motion_detector_push_frame(detector, imgA->data, imgA->size);
+    motion_detector_push_frame(detector, imgB->data, imgB->size);
+    unsigned long allocs = allocsNow() - before;
+
+    assert_int_equal(allocs, 0);
+    assert_int_equal(motion_detector_alloc_count(detector), 0);
+}
+
+static void test_steady_state_no_allocations(void **state) {
+#ifndef COUNT_ALLOCS
+    skip();
+#endif
+    void* detector = *state;
+
+    ImageBuffer imgA = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+
+    // detektor z fixture: Gauss, jeden wątek
+    steady_state_allocs(detector, &imgA, &imgB);
+
+    // box na dwóch wątkach, model tła
+    MotionParams params = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21,
+        .threads = 2,
+        .blur = MOTION_BLUR_BOX,
+        .mode = MOTION_MODE_BACKGROUND
+    };
+    void* other = motion_detector_init(640, 480, params);
+    assert_non_null(other);
+    steady_state_allocs(other, &imgA, &imgB);
+    motion_detector_destroy(other);
+
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
+// Test 13: Pełny wynik detekcji - ramki, powierzchnia, kafelki
+static void test_detect_ex_result(void **state) {
+    void* detector = *state;
+
+    ImageBuffer img1 = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer img2 = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(img1.data);
+    assert_non_null(img2.data);
+
+    MotionResult result;
+    bool motion = motion_detector_detect_ex(detector,
+        img2.data, img2.size, img1.data, img1.size, &result);
+
+    assert_true(motion);
+    assert_true(result.motion);
+    assert_true(result.changedArea > 0);
+    assert_true(result.score > 0.0f && result.score <= 1.0f);
+    assert_in_range(result.boxCount, 1, MOTION_MAX_BOXES);
+
+    int tilesSet = 0;
+    for (int y = 0; y < MOTION_TILES_Y; y++)
+    {
+        tilesSet += result.tiles[y] != 0;
+    }
+    assert_true(tilesSet > 0);
+
+    for (int i = 0; i < result.boxCount; i++)
+    {
+        const MotionBox* box = &result.boxes[i];
+        assert_true(box->x >= 0 && box->y >= 0);
+        assert_true(box->x + box->width <= 640);
+        assert_true(box->y + box->height <= 480);
+        assert_true(box->area > 200);
+        if (i > 0)
+        {
+            assert_true(box->area <= result.boxes[i - 1].area);
+        }
+    }
+
+    // ten sam wynik co wersja bool
+    assert_int_equal(motion, motion_detector_detect(detector,
+        img2.data, img2.size, img1.data, img1.size));
+
+    // brak ruchu - pusty wynik
+    assert_false(motion_detector_detect_ex(detector,
+        img1.data, img1.size, img1.data, img1.size, &result));
+    assert_false(result.motion);
+    assert_int_equal(result.changedArea, 0);
+    assert_int_equal(result.boxCount, 0);
+
+    free_image_buffer(&img1);
+    free_image_buffer(&img2);
+}
+
+// Test 14: Tryb modelu tła - ruch wykryty, po czasie nowa scena staje się tłem
+static void test_background_mode(void **state) {
+    (void)state;
+
+    ImageBuffer imgA = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+
+    MotionParams params = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21,
+        .analysisScale = 2,
+        .mode = MOTION_MODE_BACKGROUND,
+        .backgroundShift = 4
+    };
+
+    void* detector = motion_detector_init(640, 480, params);
+    assert_non_null(detector);
+
+    // pierwsza klatka inicjalizuje tło
+    assert_false(motion_detector_push_frame(detector, imgA.data, imgA.size));
+    // statyczna scena
+    for (int i = 0; i < 5; i++)
+    {
+        assert_false(motion_detector_push_frame(detector, imgA.data, imgA.size));
+    }
+
+    // zmiana sceny - ruch
+    assert_true(motion_detector_push_frame(detector, imgB.data, imgB.size));
+
+    // scena B pozostaje - model tła dochodzi do B
+    bool motion = true;
+    for (int i = 0; i < 80 && motion; i++)
+    {
+        motion = motion_detector_push_frame(detector, imgB.data, imgB.size);
+    }
+    assert_false(motion);
+
+    assert_int_equal(motion_detector_alloc_count(detector), 0);
+    motion_detector_destroy(detector);
+
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
+// Test 15: Rozmycie boxem - stały obraz bez zmian, detekcja jak z Gaussem
+static void test_box_blur(void **state) {
+    (void)state;
+
+    // stały obraz pozostaje stały (także przy promieniu większym niż obraz)
+    unsigned char flat[32 * 8];
+    unsigned char tmp[32 * 8];
+    unsigned int colSums[32];
+    memset(flat, 173, sizeof(flat));
+    box_blur_u8(flat, 32, flat, 32, 32, 8, 10, 3, tmp, colSums);
+    for (size_t i = 0; i < sizeof(flat); i++)
+    {
+        assert_int_equal(flat[i], 173);
+    }
+
+    // sigma Gaussa 21x21 (3.5) ~ 3 przebiegi boxa o promieniu 3
+    assert_int_equal(box_blur_radius_for_gauss(21, 3), 3);
+
+    ImageBuffer img1 = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer img2 = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(img1.data);
+    assert_non_null(img2.data);
+
+    MotionParams params = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21,
+        .blur = MOTION_BLUR_BOX
+    };
+
+    void* detector = motion_detector_init(640, 480, params);
+    assert_non_null(detector);
+
+    assert_false(motion_detector_detect(detector,
+        img1.data, img1.size, img1.data, img1.size));
+    assert_true(motion_detector_detect(detector,
+        img2.data, img2.size, img1.data, img1.size));
+    assert_int_equal(motion_detector_alloc_count(detector), 0);
+
+    motion_detector_destroy(detector);
+
+    free_image_buffer(&img1);
+    free_image_buffer(&img2);
+}
+
+static void assert_results_equal(const MotionResult* a, const MotionResult* b)
+{
+    assert_int_equal(a->motion, b->motion);
+    assert_int_equal(a->changedArea, b->changedArea);
+    assert_int_equal(a->boxCount, b->boxCount);
+    assert_memory_equal(a->boxes, b->boxes, sizeof(a->boxes[0]) * a->boxCount);
+    assert_memory_equal(a->tiles, b->tiles, sizeof(a->tiles));
+}
+
+// Test 16: Analiza na pasach w wielu wątkach daje identyczny wynik jak jednowątkowa
+static void test_threaded_matches_single(void **state) {
+    (void)state;
+
+    const char* files[] = {
+        "images/move_1.yuyv", "images/move_2.yuyv",
+        "images/finger4.yuyv", "images/finger5.yuyv"
+    };
+    ImageBuffer imgs[4];
+    for (int i = 0; i < 4; i++)
+    {
+        imgs[i] = load_yuyv_file(files[i]);
+        assert_non_null(imgs[i].data);
+    }
+
+    const MotionBlur blurs[] = {MOTION_BLUR_GAUSSIAN, MOTION_BLUR_BOX};
+    const int scales[] = {1, 2};
+    for (int b = 0; b < 2; b++)
+    {
+        for (int s = 0; s < 2; s++)
+        {
+            MotionParams params = {
+                .motionThreshold = 20,
+                .minArea = 200,
+                .gaussBlur = 21,
+                .analysisScale = scales[s],
+                .blur = blurs[b],
+                .threads = 1
+            };
+            void* single = motion_detector_init(640, 480, params);
+            params.threads = 4;
+            void* threaded = motion_detector_init(640, 480, params);
+            assert_non_null(single);
+            assert_non_null(threaded);
+
+            for (int cur = 0; cur < 4; cur++)
+            {
+                int prev = cur ^ 1;
+                MotionResult expected, actual;
+                motion_detector_detect_ex(single, imgs[cur].data, imgs[cur].size,
+                                          imgs[prev].data, imgs[prev].size, &expected);
+                motion_detector_detect_ex(threaded, imgs[cur].data, imgs[cur].size,
+                                          imgs[prev].data, imgs[prev].size, &actual);
+                assert_results_equal(&expected, &actual);
+            }
+
+            motion_detector_destroy(single);
+            motion_detector_destroy(threaded);
+        }
+    }
+
+    // model tła - sekwencja klatek
+    MotionParams bgParams = {
+        .motionThreshold = 20,
+        .minArea = 200,
+        .gaussBlur = 21,
+        .mode = MOTION_MODE_BACKGROUND,
+        .threads = 1
+    };
+    void* single = motion_detector_init(640, 480, bgParams);
+    bgParams.threads = 3;
+    void* threaded = motion_detector_init(640, 480, bgParams);
+    assert_non_null(single);
+    assert_non_null(threaded);
+
+    for (int i = 0; i < 12; i++)
+    {
+        const ImageBuffer* img = &imgs[(i / 3) % 4];
+        MotionResult expected, actual;
+        motion_detector_push_frame_ex(single, img->data, img->size, &expected);
+        motion_detector_push_frame_ex(threaded, img->data, img->size, &actual);
+        assert_results_equal(&expected, &actual);
+    }
+    assert_int_equal(motion_detector_alloc_count(threaded), 0);
+
+    motion_detector_destroy(single);
+    motion_detector_destroy(threaded);
+
+    for (int i = 0; i < 4; i++)
+    {
+        free_image_buffer(&imgs[i]);
+    }
+}
+
+// Test 17: Profilowanie etapów - czasy tylko przy włączonym, wynik bez zmian
+static void test_stage_profiling(void **state) {
+    void* detector = *state;
+
+    ImageBuffer imgA = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.yuyv");
+
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+
+    bool expected = motion_detector_detect(detector, imgB.data, imgB.size, imgA.data, imgA.size);
+
+    MotionStageTimes times;
+    motion_detector_get_stage_times(detector, &times);
+    assert_int_equal(times.calls, 0);
+
+    // osobny etap progowania nie może zmienić wyniku
+    motion_detector_set_profiling(detector, true);
+    assert_int_equal(motion_detector_detect(detector, imgB.data, imgB.size, imgA.data, imgA.size), expected);
+    motion_detector_push_frame(detector, imgA.data, imgA.size);
+    motion_detector_push_frame(detector, imgB.data, imgB.size);
+
+    motion_detector_get_stage_times(detector, &times);
+    assert_int_equal(times.calls, 3);
+    assert_true(times.lumaMs > 0.0);
+    assert_true(times.blurMs > 0.0);
+    assert_true(times.diffMs > 0.0);
+    assert_true(times.thresholdMs > 0.0);
+    assert_true(times.dilateMs > 0.0);
+
+    motion_detector_reset_stage_times(detector);
+    motion_detector_get_stage_times(detector, &times);
+    assert_int_equal(times.calls, 0);
+    assert_true(times.blurMs == 0.0);
+
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
+// Test 18: Pierścień klatek - najnowsza klatka, pełny pierścień odrzuca nowe
+static void test_frame_ring_latest_and_drops(void **state) {
+    (void)state;
+
+    assert_null(frame_ring_create(1, 16));
+    assert_null(frame_ring_create(4, 0));
+
+    void* ring = frame_ring_create(3, 16);
+    assert_non_null(ring);
+
+    size_t size = 0;
+    assert_null(frame_ring_acquire_latest(ring, &size));
+
+    // pełny pierścień odrzuca nowe klatki, zamiast czekać
+    unsigned char frame[16];
+    for (int i = 0; i < 4; i++)
+    {
+        memset(frame, i, sizeof(frame));
+        bool pushed = frame_ring_push(ring, frame, 8 + i);
+        assert_int_equal(pushed, i < 3);
+    }
+    assert_int_equal(frame_ring_dropped(ring), 1);
+    assert_false(frame_ring_push(ring, frame, 17));
+    assert_int_equal(frame_ring_dropped(ring), 2);
+
+    // konsument dostaje najnowszą klatkę, starsze są pomijane
+    const unsigned char* latest = frame_ring_acquire_latest(ring, &size);
+    assert_non_null(latest);
+    assert_int_equal(size, 10);
+    assert_int_equal(latest[0], 2);
+    assert_int_equal(frame_ring_skipped(ring), 2);
+
+    // podczas odczytu producent ma wolne pozostałe sloty
+    assert_true(frame_ring_push(ring, frame, 16));
+    assert_true(frame_ring_push(ring, frame, 16));
+    assert_false(frame_ring_push(ring, frame, 16));
+    frame_ring_release(ring);
+    assert_true(frame_ring_push(ring, frame, 16));
+
+    frame_ring_destroy(ring);
+}
+
+typedef struct {
+    void* ring;
+    int frames;
+} RingProducer;
+
+static void* ring_producer(void* arg) {
+    RingProducer* producer = arg;
+    for (int i = 1; i <= producer->frames; i++)
+    {
+        unsigned char* slot;
+        while (!(slot = frame_ring_begin_write(producer->ring)))
+            sched_yield();
+        memcpy(slot, &i, sizeof(i));
+        memset(slot + sizeof(i), i & 0xff, 60);
+        frame_ring_commit_write(producer->ring, sizeof(i) + 60);
+    }
+    return NULL;
+}
+
+// Test 19: Pierścień klatek z producentem w osobnym wątku
+static void test_frame_ring_threaded(void **state) {
+    (void)state;
+
+    // producent w osobnym wątku - konsument widzi kompletne klatki w rosnącej kolejności
+    RingProducer producer = {frame_ring_create(4, 64), 5000};
+    assert_non_null(producer.ring);
+
+    pthread_t tid;
+    assert_int_equal(pthread_create(&tid, NULL, ring_producer, &producer), 0);
+
+    int last = 0;
+    while (last < producer.frames)
+    {
+        size_t size;
+        const unsigned char* frame = frame_ring_acquire_latest(producer.ring, &size);
+        if (!frame)
+        {
+            sched_yield();
+            continue;
+        }
+
+        int index;
+        memcpy(&index, frame, sizeof(index));
+        assert_int_equal(size, sizeof(index) + 60);
+        assert_true(index > last);
+        for (int i = 0; i < 60; i++)
+            assert_int_equal(frame[sizeof(index) + i], index & 0xff);
+        last = index;
+        frame_ring_release(producer.ring);
+    }
+
+    pthread_join(tid, NULL);
+    frame_ring_destroy(producer.ring);
+}
+
+// Test 20: Pula klatek - wyrównanie, liczniki referencji, zwrot slotów
+static void test_frame_pool_refcount(void **state) {
+    (void)state;
+
+    assert_null(frame_pool_create(0, 64, 0));
+    void* pool = frame_pool_create(2, 100, 16);
+    assert_non_null(pool);
+
+    FrameSlot* a = frame_pool_acquire(pool);
+    FrameSlot* b = frame_pool_acquire(pool);
+    assert_non_null(a);
+    assert_non_null(b);
+    assert_ptr_not_equal(a->data, b->data);
+    assert_int_equal((size_t)a->data % 64, 0);
+    assert_int_equal((size_t)b->data % 64, 0);
+    assert_int_equal(a->capacity, 100);
+    assert_true(a->headroom >= 16);
+
+    // zapas przed klatką nie nachodzi na poprzednią klatkę
+    unsigned char* first = a->data < b->data ? a->data : b->data;
+    unsigned char* second = a->data < b->data ? b->data : a->data;
+    assert_true(second - a->headroom >= first + 100);
+
+    // wszystkie klatki w użyciu - brak blokowania, tylko licznik
+    assert_null(frame_pool_acquire(pool));
+    assert_int_equal(frame_pool_exhausted(pool), 1);
+
+    // klatka wraca do puli dopiero po ostatniej referencji
+    memset(a->data, 7, 100);
+    a->size = 100;
+    a->timestampMs = 1234;
+    frame_slot_ref(a);
+    frame_slot_unref(a);
+    assert_int_equal(frame_pool_in_use(pool), 2);
+    assert_null(frame_pool_acquire(pool));
+    frame_slot_unref(a);
+    assert_int_equal(frame_pool_in_use(pool), 1);
+
+    FrameSlot* c = frame_pool_acquire(pool);
+    assert_ptr_equal(c, a);
+    assert_int_equal(c->size, 0);
+    assert_int_equal(c->timestampMs, 0);
+
+    frame_slot_unref(b);
+    frame_slot_unref(c);
+    frame_slot_unref(NULL);
+    assert_int_equal(frame_pool_in_use(pool), 0);
+
+    frame_pool_destroy(pool);
+}
+
+// Test 21: Koder JPEG z YUYV
+static void test_jpeg_encoder(void **state) {
+    (void)state;
+
+    assert_null(jpeg_encoder_init(640, 480, 0));
+    assert_null(jpeg_encoder_init(640, 480, 101));
+
+    ImageBuffer img = load_yuyv_file("images/move_1.yuyv");
+    assert_non_null(img.data);
+
+    void* encoder = jpeg_encoder_init(640, 480, 80);
+    assert_non_null(encoder);
+
+    size_t capacity = 640 * 480;
+    unsigned char* out = malloc(capacity);
+    assert_non_null(out);
+
+    // JPEG (SOI ... EOI), wielokrotnie mniejszy niż surowe YUYV
+    size_t size = jpeg_encoder_encode(encoder, img.data, img.size, out, capacity);
+    assert_true(size > 0);
+    assert_true(size < img.size / 4);
+    assert_int_equal(out[0], 0xFF);
+    assert_int_equal(out[1], 0xD8);
+    assert_int_equal(out[size - 2], 0xFF);
+    assert_int_equal(out[size - 1], 0xD9);
+
+    // za mały bufor wyjściowy i zły rozmiar wejścia - błąd, bez zapisu poza bufor
+    assert_int_equal(jpeg_encoder_encode(encoder, img.data, img.size, out, 100), 0);
+    assert_int_equal(jpeg_encoder_encode(encoder, img.data, img.size - 2, out, capacity), 0);
+
+    JpegEncoderStats stats;
+    jpeg_encoder_get_stats(encoder, &stats);
+    assert_int_equal(stats.frames, 1);
+    assert_int_equal(stats.failed, 2);
+    assert_int_equal(stats.lastBytes, size);
+    assert_true(stats.lastMs > 0.0);
+
+    free(out);
+    jpeg_encoder_destroy(encoder);
+    free_image_buffer(&img);
+}
+
+// Test 22: Wejście MJPEG - detekcja na luminancji dekodowanej w skali 1/4 i 1/8
+static void test_mjpeg_input(void **state) {
+    (void)state;
+
+    // pliki .jpg to klatki 800x600 - dekodowana tylko luminancja w skali 1/4 i 1/8
+    ImageBuffer imgA = load_yuyv_file("images/move_1.jpg");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.jpg");
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+
+    MotionParams params = {.motionThreshold = 20, .minArea = 200, .gaussBlur = 21,
+                           .analysisScale = 8, .input = MOTION_INPUT_MJPEG};
+    void* scaled8 = motion_detector_init(800, 600, params);
+    assert_non_null(scaled8);
+    params.analysisScale = 4;
+    void* scaled4 = motion_detector_init(800, 600, params);
+    assert_non_null(scaled4);
+
+    // skala 8 tylko dla MJPEG
+    params.input = MOTION_INPUT_YUYV;
+    params.analysisScale = 8;
+    assert_null(motion_detector_init(800, 600, params));
+
+    void* detectors[] = {scaled4, scaled8};
+    for (int i = 0; i < 2; i++)
+    {
+        assert_false(motion_detector_push_frame(detectors[i], imgA.data, imgA.size));
+        assert_false(motion_detector_push_frame(detectors[i], imgA.data, imgA.size));
+        assert_true(motion_detector_push_frame(detectors[i], imgB.data, imgB.size));
+        assert_true(motion_detector_detect(detectors[i], imgA.data, imgA.size, imgB.data, imgB.size));
+        assert_false(motion_detector_detect(detectors[i], imgB.data, imgB.size, imgB.data, imgB.size));
+        assert_int_equal(motion_detector_alloc_count(detectors[i]), 0);
+    }
+
+    // dane, które nie są JPEG, lub inna rozdzielczość niż przy init - brak ruchu
+    unsigned char garbage[256] = {0};
+    assert_false(motion_detector_push_frame(scaled4, garbage, sizeof(garbage)));
+    params.input = MOTION_INPUT_MJPEG;
+    params.analysisScale = 4;
+    void* wrongSize = motion_detector_init(640, 480, params);
+    assert_non_null(wrongSize);
+    assert_false(motion_detector_push_frame(wrongSize, imgA.data, imgA.size));
+    assert_false(motion_detector_push_frame(wrongSize, imgB.data, imgB.size));
+
+    motion_detector_destroy(scaled4);
+    motion_detector_destroy(scaled8);
+    motion_detector_destroy(wrongSize);
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
+// pakiet ma ustawioną flagę klatki kluczowej
+static bool packet_is_keyframe(const unsigned char* packet)
+{
+    return (packet[3] & TILE_DELTA_KEYFRAME) != 0;
+}
+
+// Test 23: Strumień delt kafelków - dekoder referencyjny odtwarza klatki bit w bit
+static void test_tile_delta(void **state) {
+    (void)state;
+
+    assert_null(tile_delta_init(640, 480, 15, 0, 4));   // nieparzysty kafelek
+    assert_null(tile_delta_init(640, 480, 0, 0, 4));
+    assert_null(tile_delta_init(640, 480, 64, 0, 4));   // 480 % 64 != 0
+    assert_null(tile_delta_init(640, 480, 16, 0, 0));
+    assert_null(tile_delta_init(640, 480, 16, -1, 4));
+
+    ImageBuffer imgA = load_yuyv_file("images/move_1.yuyv");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.yuyv");
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+    size_t frameSize = imgA.size;
+
+    // A z fragmentem B - zmienia się tylko kilka kafelków
+    unsigned char* patched = malloc(frameSize);
+    assert_non_null(patched);
+    memcpy(patched, imgA.data, frameSize);
+    for (int y = 100; y < 140; y++)
+        memcpy(patched + (y * 640 + 100) * 2, imgB.data + (y * 640 + 100) * 2, 40 * 2);
+
+    size_t capacity = tile_delta_max_packet_size(640, 480);
+    assert_int_equal(capacity, TILE_DELTA_HEADER_SIZE + frameSize);
+    unsigned char* packet = malloc(capacity);
+    unsigned char* decoded = calloc(1, frameSize);
+    assert_non_null(packet);
+    assert_non_null(decoded);
+
+    // próg 0 - odbiorca odtwarza każdą klatkę bit w bit
+    void* encoder = tile_delta_init(640, 480, 16, 0, 4);
+    assert_non_null(encoder);
+
+    // 1: klatka kluczowa
+    size_t size = tile_delta_encode(encoder, imgA.data, frameSize, packet, capacity);
+    assert_int_equal(size, capacity);
+    assert_true(tile_delta_is_keyframe(packet, size));
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    assert_memory_equal(decoded, imgA.data, frameSize);
+
+    // 2: bez zmian - sam nagłówek
+    size = tile_delta_encode(encoder, imgA.data, frameSize, packet, capacity);
+    assert_int_equal(size, TILE_DELTA_HEADER_SIZE);
+    assert_false(tile_delta_is_keyframe(packet, size));
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    assert_memory_equal(decoded, imgA.data, frameSize);
+
+    // 3: obszar 40x40 od (100,100) - kafelki 6..8 x 6..8
+    size = tile_delta_encode(encoder, patched, frameSize, packet, capacity);
+    assert_false(packet_is_keyframe(packet));
+    assert_int_equal(size, TILE_DELTA_HEADER_SIZE + 9 * (2 + 16 * 16 * 2));
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    assert_memory_equal(decoded, patched, frameSize);
+
+    // 4: cała nowa klatka - różnicowa albo kluczowa, zawsze bit w bit
+    size = tile_delta_encode(encoder, imgB.data, frameSize, packet, capacity);
+    assert_true(size > TILE_DELTA_HEADER_SIZE);
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    assert_memory_equal(decoded, imgB.data, frameSize);
+
+    // 5: keyframeInterval = 4 - znowu klatka kluczowa; potem wymuszona
+    size = tile_delta_encode(encoder, imgB.data, frameSize, packet, capacity);
+    assert_true(tile_delta_is_keyframe(packet, size));
+    size = tile_delta_encode(encoder, imgB.data, frameSize, packet, capacity);
+    assert_false(packet_is_keyframe(packet));
+    tile_delta_force_keyframe(encoder);
+    size = tile_delta_encode(encoder, imgB.data, frameSize, packet, capacity);
+    assert_true(tile_delta_is_keyframe(packet, size));
+
+    // uszkodzony pakiet różnicowy i inna rozdzielczość - obraz odbiorcy bez zmian
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    memcpy(patched, imgB.data, frameSize);
+    for (int y = 100; y < 140; y++)
+        memcpy(patched + (y * 640 + 100) * 2, imgA.data + (y * 640 + 100) * 2, 40 * 2);
+    size = tile_delta_encode(encoder, patched, frameSize, packet, capacity);
+    assert_false(packet_is_keyframe(packet));
+    assert_false(tile_delta_decode(packet, size, decoded, 320, 240));
+    assert_false(tile_delta_decode(packet, size - 1, decoded, 640, 480));
+    packet[TILE_DELTA_HEADER_SIZE] = 0xFF;
+    packet[TILE_DELTA_HEADER_SIZE + 1] = 0xFF;
+    assert_false(tile_delta_decode(packet, size, decoded, 640, 480));
+    assert_memory_equal(decoded, imgB.data, frameSize);
+
+    // za mały bufor i zły rozmiar wejścia
+    assert_int_equal(tile_delta_encode(encoder, imgA.data, frameSize, packet, 100), 0);
+    assert_int_equal(tile_delta_encode(encoder, imgA.data, frameSize - 2, packet, capacity), 0);
+
+    TileDeltaStats stats;
+    tile_delta_get_stats(encoder, &stats);
+    assert_int_equal(stats.frames, 8);
+    assert_int_equal(stats.failed, 2);
+    assert_true(stats.keyframes >= 3);
+    assert_true(stats.tilesSent >= 9 + 9);
+    tile_delta_destroy(encoder);
+
+    // próg > 0: drobna zmiana nie jest wysyłana - odbiorca zgodny z obrazem kodera
+    encoder = tile_delta_init(640, 480, 16, 4, 100);
+    assert_non_null(encoder);
+    size = tile_delta_encode(encoder, imgA.data, frameSize, packet, capacity);
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    memcpy(patched, imgA.data, frameSize);
+    patched[0] ^= 0x01;
+    size = tile_delta_encode(encoder, patched, frameSize, packet, capacity);
+    assert_int_equal(size, TILE_DELTA_HEADER_SIZE);
+    assert_true(tile_delta_decode(packet, size, decoded, 640, 480));
+    assert_memory_equal(decoded, imgA.data, frameSize);
+    tile_delta_destroy(encoder);
+
+    free(decoded);
+    free(packet);
+    free(patched);
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
+// czeka (maks. ~2 s) aż wątek zapisu zamknie `clips` plików / zapisze `frames` klatek
+static ClipRecorderStats wait_for_clip_stats(void* recorder, unsigned long clips, unsigned long frames)
+{
+    ClipRecorderStats stats;
+    for (int i = 0; i < 2000; i++)
+    {
+        clip_recorder_get_stats(recorder, &stats);
+        if (stats.clips >= clips && stats.framesWritten >= frames)
+            break;
+        usleep(1000);
+    }
+    return stats;
+}
+
+static unsigned read_u32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+// Test 24: Nagrywanie klipów - bufor przed zdarzeniem, pliki AVI
+static void test_clip_recorder(void **state) {
+    (void)state;
+
+    char dir[] = "/tmp/cam_clips_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+
+    ClipRecorderParams params = {.directory = dir, .width = 64, .height = 48, .fps = 5,
+                                 .preSeconds = 1, .postSeconds = 1, .maxClipSeconds = 60,
+                                 .memoryLimit = 1024 * 1024};
+    ClipRecorderParams bad = params;
+    bad.fps = 0;
+    assert_null(clip_recorder_init(bad));
+    bad = params;
+    bad.memoryLimit = 0;
+    assert_null(clip_recorder_init(bad));
+
+    void* recorder = clip_recorder_init(params);
+    assert_non_null(recorder);
+
+    // klatka i: 1001 bajtów (nieparzysty rozmiar - wyrównanie chunków) wypełnionych i
+    unsigned char frame[1001];
+
+    // 0..1800 ms - w pre-rollu zostaje ostatnia sekunda (800..1800, 6 klatek)
+    for (int i = 0; i < 10; i++)
+    {
+        memset(frame, i, sizeof(frame));
+        assert_true(clip_recorder_push(recorder, frame, sizeof(frame), i * 200));
+    }
+    clip_recorder_trigger(recorder, 1800);
+
+    // post-roll do 2800 ms; klatka 3000 ms zamyka klip
+    for (int i = 10; i < 17; i++)
+    {
+        memset(frame, i, sizeof(frame));
+        assert_true(clip_recorder_push(recorder, frame, sizeof(frame), i * 200));
+    }
+
+    ClipRecorderStats stats = wait_for_clip_stats(recorder, 1, 11);
+    assert_int_equal(stats.clips, 1);
+    assert_int_equal(stats.framesWritten, 11);
+    assert_int_equal(stats.framesDropped, 0);
+    assert_int_equal(stats.writeErrors, 0);
+
+    // plik AVI: nagłówek z uzupełnionymi licznikami, pierwsza klatka z pre-rollu, indeks
+    ImageBuffer avi = load_yuyv_file(stats.lastPath);
+    assert_non_null(avi.data);
+    assert_memory_equal(avi.data, "RIFF", 4);
+    assert_int_equal(read_u32(avi.data + 4), avi.size - 8);
+    assert_memory_equal(avi.data + 8, "AVI ", 4);
+    assert_int_equal(read_u32(avi.data + 48), 11);
+    assert_memory_equal(avi.data + 220, "movi", 4);
+    assert_memory_equal(avi.data + 224, "00dc", 4);
+    assert_int_equal(read_u32(avi.data + 228), 1001);
+    assert_int_equal(avi.data[232], 4);
+    size_t idx = 220 + read_u32(avi.data + 216);
+    assert_memory_equal(avi.data + idx, "idx1", 4);
+    assert_int_equal(read_u32(avi.data + idx + 4), 11 * 16);
+    assert_int_equal(idx + 8 + 11 * 16, avi.size);
+    remove(stats.lastPath);
+    free_image_buffer(&avi);
+    clip_recorder_destroy(recorder);
+
+    // bufor 3000 B: z klatek po 1000 B zostają najwyżej 3, niezależnie od pre-rollu
+    params.preSeconds = 10;
+    params.memoryLimit = 3000;
+    recorder = clip_recorder_init(params);
+    assert_non_null(recorder);
+    unsigned char big[4000] = {0};
+    assert_false(clip_recorder_push(recorder, big, sizeof(big), 0));
+    for (int i = 0; i < 10; i++)
+        assert_true(clip_recorder_push(recorder, big, 1000, i * 200));
+    clip_recorder_trigger(recorder, 1800);
+
+    stats = wait_for_clip_stats(recorder, 0, 3);
+    assert_int_equal(stats.framesWritten, 3);
+    assert_int_equal(stats.framesDropped, 1);
+    clip_recorder_destroy(recorder);
+
+    // sprzątanie - plik drugiego rejestratora został zamknięty w destroy
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    assert_int_equal(system(command), 0);
+}
+
+// Test 25: Regulator tempa analizy - aktywność, powrót do spoczynku, budżet CPU
+static void test_analysis_governor(void **state) {
+    (void)state;
+
+    GovernorParams params = {.fps = 30, .activeStep = 1, .idleStep = 30, .holdMs = 5000, .cpuBudget = 0.5};
+    GovernorParams bad = params;
+    bad.idleStep = 0;
+    assert_null(analysis_governor_init(bad));
+    bad = params;
+    bad.cpuBudget = 0.0;
+    assert_null(analysis_governor_init(bad));
+
+    void* governor = analysis_governor_init(params);
+    assert_non_null(governor);
+    assert_int_equal(analysis_governor_step(governor), 30);
+
+    // spokój - tempo spoczynkowe; ruch - każda klatka, także przez holdMs po ruchu
+    assert_int_equal(analysis_governor_update(governor, false, 2.0, 0), 30);
+    assert_int_equal(analysis_governor_update(governor, true, 2.0, 100), 1);
+    assert_int_equal(analysis_governor_step(governor), 1);
+    assert_int_equal(analysis_governor_update(governor, false, 2.0, 5100), 1);
+
+    // po holdMs krok rośnie dwukrotnie aż do idleStep
+    int expected[] = {2, 4, 8, 16, 30, 30};
+    for (int i = 0; i < 6; i++)
+        assert_int_equal(analysis_governor_update(governor, false, 2.0, 5200 + i * 100), expected[i]);
+
+    // ponowny ruch - natychmiast z powrotem
+    assert_int_equal(analysis_governor_update(governor, true, 2.0, 7000), 1);
+
+    GovernorStats stats;
+    analysis_governor_get_stats(governor, &stats);
+    assert_int_equal(stats.updates, 10);
+    assert_int_equal(stats.budgetLimited, 0);
+    assert_int_equal(stats.step, 1);
+    assert_true(stats.avgAnalysisMs > 1.9 && stats.avgAnalysisMs < 2.1);
+    analysis_governor_destroy(governor);
+
+    // wolny detektor (50 ms): każda klatka to 150% rdzenia - budżet 50% wymusza krok 3
+    governor = analysis_governor_init(params);
+    assert_non_null(governor);
+    assert_int_equal(analysis_governor_update(governor, true, 50.0, 0), 3);
+    analysis_governor_get_stats(governor, &stats);
+    assert_int_equal(stats.budgetLimited, 1);
+    assert_true(stats.cpuLoad <= 0.5 + 1e-9);
+
+    // zmierzone tempo źródła 10/s (fps <= 0 ignorowane): 50 ms co klatkę to już tylko 50% rdzenia
+    analysis_governor_set_fps(governor, 0.0);
+    assert_int_equal(analysis_governor_update(governor, true, 50.0, 100), 3);
+    analysis_governor_set_fps(governor, 10.0);
+    assert_int_equal(analysis_governor_update(governor, true, 50.0, 200), 1);
+    analysis_governor_destroy(governor);
+}
+
+// źródło testowe puli analizy - zadanie trwa chwilę i sprawdza, czy nie biegnie równolegle samo ze sobą
+typedef struct {
+    int running;
+    int overlaps;
+    int runs;
+} PoolTestSource;
+
+static void pool_test_task(void* ptr)
+{
+    PoolTestSource* source = (PoolTestSource*)ptr;
+    if (__atomic_add_fetch(&source->running, 1, __ATOMIC_ACQ_REL) > 1)
+        __atomic_add_fetch(&source->overlaps, 1, __ATOMIC_RELAXED);
+    usleep(2000);
+    __atomic_add_fetch(&source->runs, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&source->running, 1, __ATOMIC_ACQ_REL);
+}
+
+// Test 26: Wspólna pula analizy - każde źródło obsłużone, nigdy na dwóch wątkach naraz
+static void test_analysis_pool(void **state) {
+    (void)state;
+
+    assert_null(analysis_pool_create(0, 4));
+    assert_null(analysis_pool_create(2, 0));
+
+    void* pool = analysis_pool_create(2, 4);
+    assert_non_null(pool);
+
+    PoolTestSource sources[4];
+    memset(sources, 0, sizeof(sources));
+    int ids[4];
+    for (int i = 0; i < 4; i++) {
+        ids[i] = analysis_pool_add_source(pool, pool_test_task, &sources[i]);
+        assert_int_equal(ids[i], i);
+    }
+    assert_int_equal(analysis_pool_add_source(pool, pool_test_task, &sources[0]), -1);
+
+    // kamera 0 zgłasza klatki bez przerwy, pozostałe co jakiś czas - zgłoszenia
+    // kamery 0 są łączone, a jej zadanie wraca na koniec kolejki, więc reszta nie czeka
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 50; i++)
+            analysis_pool_notify(pool, ids[0]);
+        for (int i = 1; i < 4; i++)
+            analysis_pool_notify(pool, ids[i]);
+        usleep(5000);
+    }
+    analysis_pool_stop(pool);
+
+    for (int i = 0; i < 4; i++) {
+        AnalysisPoolStats stats;
+        analysis_pool_get_stats(pool, ids[i], &stats);
+        assert_int_equal(sources[i].overlaps, 0);
+        assert_int_equal(stats.runs, (unsigned long)sources[i].runs);
+        assert_true(sources[i].runs >= 1);
+        assert_true(stats.runs <= stats.notifications);
+    }
+    AnalysisPoolStats flooded;
+    analysis_pool_get_stats(pool, ids[0], &flooded);
+    assert_int_equal(flooded.notifications, 1000);
+    assert_true(flooded.runs < 1000);
+
+    // po zatrzymaniu zgłoszenia są ignorowane
+    int runs = sources[1].runs;
+    analysis_pool_notify(pool, ids[1]);
+    usleep(5000);
+    assert_int_equal(sources[1].runs, runs);
+    analysis_pool_destroy(pool);
+}
+
+// odbiornik testowy źródła odtwarzania - pierwszy bajt każdej klatki
+typedef struct {
+    int frames;
+    size_t size;
+    unsigned char first[16];
+} ReplayTestSink;
+
+static void replay_test_frame(const unsigned char* data, size_t size, void* user)
+{
+    ReplayTestSink* sink = (ReplayTestSink*)user;
+    if (sink->frames < 16)
+        sink->first[sink->frames] = data[0];
+    sink->size = size;
+    sink->frames++;
+}
+
+static bool wait_for_replay(CaptureSource* source)
+{
+    for (int i = 0; i < 2000 && !capture_source_finished(source); i++)
+        usleep(1000);
+    return capture_source_finished(source);
+}
+
+// plik z klatkami 64x48 wypełnionymi kolejno values[0], values[1], ...
+static void write_replay_file(const char* dir, const char* name, const unsigned char* values, int frames)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* f = fopen(path, "wb");
+    assert_non_null(f);
+    unsigned char frame[64 * 48 * 2];
+    for (int i = 0; i < frames; i++) {
+        memset(frame, values[i], sizeof(frame));
+        assert_int_equal(fwrite(frame, 1, sizeof(frame), f), sizeof(frame));
+    }
+    fclose(f);
+}
+
+// Test 27: Odtwarzanie klatek z plików .yuyv
+static void test_replay_source(void **state) {
+    (void)state;
+
+    char dir[] = "/tmp/cam_replay_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+    unsigned char first[] = {1};
+    unsigned char second[] = {3, 4};
+    write_replay_file(dir, "b.yuyv", second, 2);
+    write_replay_file(dir, "a.yuyv", first, 1);
+    write_replay_file(dir, "notes.txt", first, 1);
+
+    ReplaySourceParams params = {.path = dir, .width = 64, .height = 48, .fps = 0,
+                                 .jitterMs = 0, .loops = 2, .seed = 1};
+    ReplaySourceParams bad = params;
+    bad.width = 0;
+    assert_null(replay_source_open(bad));
+    bad = params;
+    bad.path = "/nonexistent/replay.yuyv";
+    assert_null(replay_source_open(bad));
+    bad = params;
+    bad.width = 32;     // rozmiar pliku nie jest wielokrotnością klatki 32x48
+    bad.height = 100;
+    assert_null(replay_source_open(bad));
+
+    // katalog: pliki .yuyv w kolejności nazw, wszystkie klatki pliku po kolei
+    CaptureSource* source = replay_source_open(params);
+    assert_non_null(source);
+    assert_string_equal(capture_source_name(source), "replay");
+    CaptureInfo info;
+    capture_source_get_info(source, &info);
+    assert_int_equal(info.format, CAPTURE_FORMAT_YUYV);
+    assert_int_equal(info.maxFrameSize, 64 * 48 * 2);
+
+    ReplayTestSink sink;
+    memset(&sink, 0, sizeof(sink));
+    assert_true(capture_source_start(source, replay_test_frame, &sink));
+    assert_false(capture_source_start(source, replay_test_frame, &sink));
+    assert_true(wait_for_replay(source));
+    unsigned char expected[] = {1, 3, 4, 1, 3, 4};
+    assert_int_equal(sink.frames, 6);
+    assert_int_equal(sink.size, 64 * 48 * 2);
+    assert_memory_equal(sink.first, expected, sizeof(expected));
+    CaptureStats stats;
+    capture_source_get_stats(source, &stats);
+    assert_int_equal(stats.frames, 6);
+    capture_source_destroy(source);
+
+    // tempo: 10 klatek przy 100 fps to ~90 ms od pierwszej do ostatniej, także z jitterem
+    char path[128];
+    snprintf(path, sizeof(path), "%s/a.yuyv", dir);
+    params.path = path;
+    params.fps = 100;
+    params.jitterMs = 3;
+    params.loops = 10;
+    source = replay_source_open(params);
+    assert_non_null(source);
+    memset(&sink, 0, sizeof(sink));
+    assert_true(capture_source_start(source, replay_test_frame, &sink));
+    assert_true(wait_for_replay(source));
+    capture_source_get_stats(source, &stats);
+    assert_int_equal(stats.frames, 10);
+    assert_true(stats.elapsedMs >= 80.0);
+    capture_source_destroy(source);
+
+    // bez końca - zatrzymanie w trakcie odtwarzania
+    params.fps = 1000;
+    params.jitterMs = 0;
+    params.loops = 0;
+    source = replay_source_open(params);
+    assert_non_null(source);
+    memset(&sink, 0, sizeof(sink));
+    assert_true(capture_source_start(source, replay_test_frame, &sink));
+    usleep(20000);
+    capture_source_stop(source);
+    assert_false(capture_source_finished(source));
+    int frames = sink.frames;
+    assert_true(frames > 0);
+    usleep(5000);
+    assert_int_equal(sink.frames, frames);
+    capture_source_destroy(source);
+
+    // obrazy testowe 640x480
+    params.path = "images";
+    params.width = 640;
+    params.height = 480;
+    params.fps = 0;
+    params.loops = 1;
+    source = replay_source_open(params);
+    assert_non_null(source);
+    memset(&sink, 0, sizeof(sink));
+    assert_true(capture_source_start(source, replay_test_frame, &sink));
+    assert_true(wait_for_replay(source));
+    assert_int_equal(sink.frames, 4);
+    assert_int_equal(sink.size, 640 * 480 * 2);
+    capture_source_destroy(source);
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    assert_int_equal(system(command), 0);
+}
 
 // ============ MAIN ============
 
+// Test 28: Uszkodzony JPEG po poprawnej klatce - false i stan detektora bez zmian
+static void test_mjpeg_garbage_keeps_state(void **state) {
+    (void)state;
+
+    ImageBuffer imgA = load_yuyv_file("images/move_1.jpg");
+    ImageBuffer imgB = load_yuyv_file("images/move_2.jpg");
+    assert_non_null(imgA.data);
+    assert_non_null(imgB.data);
+
+    MotionParams params = {.motionThreshold = 20, .minArea = 200, .gaussBlur = 21,
+                           .analysisScale = 4, .input = MOTION_INPUT_MJPEG};
+    void* detector = motion_detector_init(800, 600, params);
+    assert_non_null(detector);
+
+    // poprzednia klatka strumienia: A; ostatnio zdekodowana luminancja: B
+    assert_false(motion_detector_push_frame(detector, imgA.data, imgA.size));
+    assert_true(motion_detector_detect(detector, imgA.data, imgA.size, imgB.data, imgB.size));
+
+    // śmieci nie mogą porównać resztek B z A ani zastąpić poprzedniej klatki
+    unsigned char garbage[256];
+    memset(garbage, 0xA5, sizeof(garbage));
+    MotionResult result;
+    assert_false(motion_detector_push_frame_ex(detector, garbage, sizeof(garbage), &result));
+    assert_false(result.motion);
+    assert_false(motion_detector_push_frame(detector, imgA.data, imgA.size));
+    assert_true(motion_detector_push_frame(detector, imgB.data, imgB.size));
+
+    motion_detector_destroy(detector);
+    free_image_buffer(&imgA);
+    free_image_buffer(&imgB);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test_setup_teardown(test_no_motion_same_image, setup, teardown),
@@ -317,6 +1585,27 @@ int main(void) {
         cmocka_unit_test_setup_teardown(test_yuyv_validation, setup, teardown),
         cmocka_unit_test_setup_teardown(test_motion_parameters_big_movment, setup, teardown),
         cmocka_unit_test_setup_teardown(test_motion_parameters_small_movment, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_push_frame_stream, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_push_frame_matches_detect, setup, teardown),
+        cmocka_unit_test(test_luma_variants_match_scalar),
+        cmocka_unit_test(test_downscaled_analysis),
+        cmocka_unit_test_setup_teardown(test_steady_state_no_allocations, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_detect_ex_result, setup, teardown),
+        cmocka_unit_test(test_background_mode),
+        cmocka_unit_test(test_box_blur),
+        cmocka_unit_test(test_threaded_matches_single),
+        cmocka_unit_test_setup_teardown(test_stage_profiling, setup, teardown),
+        cmocka_unit_test(test_frame_ring_latest_and_drops),
+        cmocka_unit_test(test_frame_ring_threaded),
+        cmocka_unit_test(test_frame_pool_refcount),
+        cmocka_unit_test(test_jpeg_encoder),
+        cmocka_unit_test(test_mjpeg_input),
+        cmocka_unit_test(test_tile_delta),
+        cmocka_unit_test(test_clip_recorder),
+        cmocka_unit_test(test_analysis_governor),
+        cmocka_unit_test(test_analysis_pool),
+        cmocka_unit_test(test_replay_source),
+        cmocka_unit_test(test_mjpeg_garbage_keeps_state),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,93 @@
+#include "capture_source.h"
+#include <new>
+#include <string.h>
+
+struct CaptureSource {
+    const CaptureSourceOps* ops;
+    void* impl;
+    CaptureInfo info;
+    bool started;
+};
+
+CaptureSource* capture_source_create(const CaptureSourceOps* ops, void* impl, CaptureInfo info)
+{
+    if(!ops)
+        return NULL;
+    if(!impl)
+        return NULL;
+
+    CaptureSource* source = new (std::nothrow) CaptureSource();
+    if(!source)
+    {
+        ops->destroy(impl);
+        return NULL;
+    }
+
+    source->ops = ops;
+    source->impl = impl;
+    source->info = info;
+    source->started = false;
+    return source;
+}
+
+bool capture_source_start(CaptureSource* source, CaptureFrameFn onFrame, void* user)
+{
+    if(!source || !onFrame || source->started)
+        return false;
+
+    source->started = source->ops->start(source->impl, onFrame, user);
+    return source->started;
+}
+
+void capture_source_stop(CaptureSource* source)
+{
+    if(!source || !source->started)
+        return;
+
+    source->ops->stop(source->impl);
+    source->started = false;
+}
+
+bool capture_source_finished(CaptureSource* source)
+{
+    if(!source || !source->ops->finished)
+        return false;
+    return source->ops->finished(source->impl);
+}
+
+void capture_source_get_info(CaptureSource* source, CaptureInfo* info)
+{
+    if(!info)
+        return;
+    memset(info, 0, sizeof(*info));
+    if(!source)
+        return;
+
+    *info = source->info;
+}
+
+void capture_source_get_stats(CaptureSource* source, CaptureStats* stats)
+{
+    if(!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if(!source)
+        return;
+
+    source->ops->get_stats(source->impl, stats);
+}
+
+const char* capture_source_name(CaptureSource* source)
+{
+    return source ? source->ops->name : "";
+}
+
+void capture_source_destroy(CaptureSource* source)
+{
+    if(!source)
+        return;
+
+    capture_source_stop(source);
+    source->ops->destroy(source->impl);
+    delete source;
+}
@@ -0,0 +1,95 @@
+#ifndef CAPTURE_SOURCE_H
+#define CAPTURE_SOURCE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Źródło klatek dla potoku kamery: kamera UVC (uvc_source.h) albo
+     * odtwarzanie plików .yuyv (replay_source.h). Potok widzi tylko ten
+     * interfejs - klatki dostaje przez CaptureFrameFn z wątku źródła.
+     */
+
+    typedef enum {
+        CAPTURE_FORMAT_YUYV,
+        CAPTURE_FORMAT_MJPEG
+    } CaptureFormat;
+
+    typedef struct {
+        CaptureFormat format;
+        int width;
+        int height;
+        size_t maxFrameSize;    // YUYV: dokładny rozmiar klatki, MJPEG: górne ograniczenie
+    } CaptureInfo;
+
+    // Statystyki od capture_source_start
+    typedef struct {
+        unsigned long frames;       // klatki przekazane do CaptureFrameFn
+        unsigned long rejected;     // klatki odrzucone przez źródło (zły format)
+        unsigned long late;         // odtwarzanie: klatki wydane po terminie
+        double elapsedMs;           // od startu do ostatniej klatki
+    } CaptureStats;
+
+    /**
+     * Nowa klatka - wywoływana z wątku źródła; dane ważne tylko do powrotu
+     */
+    typedef void (*CaptureFrameFn)(const unsigned char* data, size_t size, void* user);
+
+    typedef struct CaptureSource CaptureSource;
+
+    /**
+     * Uruchomienie dostarczania klatek (raz na źródło)
+     */
+    bool capture_source_start(CaptureSource* source, CaptureFrameFn onFrame, void* user);
+
+    /**
+     * Zatrzymanie - po powrocie onFrame nie jest już wywoływana
+     */
+    void capture_source_stop(CaptureSource* source);
+
+    /**
+     * true gdy źródło samo się skończyło (koniec odtwarzania)
+     */
+    bool capture_source_finished(CaptureSource* source);
+
+    void capture_source_get_info(CaptureSource* source, CaptureInfo* info);
+
+    void capture_source_get_stats(CaptureSource* source, CaptureStats* stats);
+
+    /**
+     * Nazwa backendu do logów ("uvc", "replay")
+     */
+    const char* capture_source_name(CaptureSource* source);
+
+    /**
+     * Zatrzymanie (jeśli działa) i zwolnienie źródła
+     */
+    void capture_source_destroy(CaptureSource* source);
+
+    // ---- dla backendów ----
+
+    typedef struct {
+        const char* name;
+        bool (*start)(void* impl, CaptureFrameFn onFrame, void* user);
+        void (*stop)(void* impl);
+        bool (*finished)(void* impl);       // NULL = nigdy
+        void (*get_stats)(void* impl, CaptureStats* stats);
+        void (*destroy)(void* impl);
+    } CaptureSourceOps;
+
+    /**
+     * Opakowanie implementacji backendu; ops muszą żyć dłużej niż źródło (static)
+     * Zwraca: źródło przejmujące impl lub NULL (wtedy impl zwalnia ops->destroy)
+     */
+    CaptureSource* capture_source_create(const CaptureSourceOps* ops, void* impl, CaptureInfo info);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_SOURCE_H
@@ -0,0 +1,518 @@
+#include "clip_recorder.h"
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CLIP_WRITE_BUFFER (256 * 1024)  // bufor stdio - karta SD dostaje duże, ciągłe zapisy
+
+// ============ AVI (RIFF, MJPEG) ============
+
+// stałe położenia pól w nagłówku pisanym przez writeAviHeader
+#define AVI_HEADER_SIZE 224
+#define AVI_RIFF_SIZE_POS 4
+#define AVI_TOTAL_FRAMES_POS 48     // avih.dwTotalFrames
+#define AVI_STREAM_LENGTH_POS 140   // strh.dwLength
+#define AVI_MOVI_SIZE_POS 216
+#define AVI_MOVI_START 220          // fourcc 'movi' - od niego liczone są przesunięcia w idx1
+#define AVI_KEYFRAME 0x10           // AVIF_HASINDEX / AVIIF_KEYFRAME
+
+struct AviIndexEntry {
+    uint32_t offset;
+    uint32_t size;
+};
+
+static inline void put32(unsigned char* p, uint32_t v)
+{
+    p[0] = (unsigned char)(v & 0xFF);
+    p[1] = (unsigned char)((v >> 8) & 0xFF);
+    p[2] = (unsigned char)((v >> 16) & 0xFF);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static inline void put16(unsigned char* p, unsigned v)
+{
+    p[0] = (unsigned char)(v & 0xFF);
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void putFourcc(unsigned char* p, const char* fourcc)
+{
+    memcpy(p, fourcc, 4);
+}
+
+// nagłówek z zerowymi licznikami - uzupełnia je closeClip
+static void writeAviHeader(unsigned char* h, int width, int height, int fps)
+{
+    memset(h, 0, AVI_HEADER_SIZE);
+    putFourcc(h, "RIFF");
+    putFourcc(h + 8, "AVI ");
+
+    putFourcc(h + 12, "LIST");
+    put32(h + 16, 192);
+    putFourcc(h + 20, "hdrl");
+
+    putFourcc(h + 24, "avih");
+    put32(h + 28, 56);
+    put32(h + 32, 1000000 / fps);           // dwMicroSecPerFrame
+    put32(h + 44, AVI_KEYFRAME);            // dwFlags = AVIF_HASINDEX
+    put32(h + 56, 1);                       // dwStreams
+    put32(h + 64, width);
+    put32(h + 68, height);
+
+    putFourcc(h + 88, "LIST");
+    put32(h + 92, 116);
+    putFourcc(h + 96, "strl");
+
+    putFourcc(h + 100, "strh");
+    put32(h + 104, 56);
+    putFourcc(h + 108, "vids");
+    putFourcc(h + 112, "MJPG");
+    put32(h + 128, 1);                      // dwScale
+    put32(h + 132, fps);                    // dwRate
+    put32(h + 148, 0xFFFFFFFF);             // dwQuality = domyślna
+    put16(h + 160, width);                  // rcFrame
+    put16(h + 162, height);
+
+    putFourcc(h + 164, "strf");
+    put32(h + 168, 40);
+    put32(h + 172, 40);                     // BITMAPINFOHEADER.biSize
+    put32(h + 176, width);
+    put32(h + 180, height);
+    put16(h + 184, 1);                      // biPlanes
+    put16(h + 186, 24);                     // biBitCount
+    putFourcc(h + 188, "MJPG");
+    put32(h + 192, (uint32_t)width * height * 3);
+
+    putFourcc(h + 212, "LIST");
+    putFourcc(h + AVI_MOVI_START, "movi");
+}
+
+// ============ REJESTRATOR ============
+
+struct ClipFrame {
+    size_t offset;          // położenie w data
+    size_t size;
+    long long timeMs;
+};
+
+struct ClipRecorder {
+    ClipRecorderParams params;
+    std::string directory;
+    long long preMs;
+    long long postMs;
+    size_t maxClipFrames;
+
+    // bufor klatek: dane kolejnych klatek jedna za drugą, z zawinięciem na
+    // początek gdy klatka nie mieści się do końca; frames - pierścień opisów
+    std::vector<unsigned char> data;
+    std::vector<ClipFrame> frames;
+    size_t firstFrame;              // indeks najstarszej klatki w frames
+    size_t frameCount;
+    size_t dataWrite;               // miejsce na następną klatkę
+    unsigned long nextSeq;          // numer następnej klatki (najstarsza = nextSeq - frameCount)
+
+    // stan klipu - chroniony przez mutex
+    bool recording;
+    unsigned long writeSeq;         // następna klatka do zapisu; starszych nie zapisujemy ponownie
+    long long clipEndMs;
+    bool stopping;
+    ClipRecorderStats stats;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread writer;
+
+    // plik - tylko wątek zapisu
+    FILE* file;
+    std::vector<char> fileBuffer;
+    std::vector<AviIndexEntry> index;
+    uint32_t moviBytes;             // dane za fourcc 'movi'
+    std::string path;
+    bool fileFailed;
+    unsigned long fileNumber;       // kolejne pliki w nazwie - ta sama sekunda nie nadpisuje
+};
+
+static inline const ClipFrame& frameAt(const ClipRecorder* r, unsigned long seq)
+{
+    unsigned long oldest = r->nextSeq - r->frameCount;
+    return r->frames[(r->firstFrame + (seq - oldest)) % r->frames.size()];
+}
+
+// najstarsza klatka może zniknąć, jeśli nie czeka na zapis w bieżącym klipie
+static inline bool oldestEvictable(const ClipRecorder* r)
+{
+    return r->frameCount > 0 && (!r->recording || r->nextSeq - r->frameCount < r->writeSeq);
+}
+
+static inline void evictOldest(ClipRecorder* r)
+{
+    r->firstFrame = (r->firstFrame + 1) % r->frames.size();
+    r->frameCount--;
+    if(r->frameCount == 0)
+        r->dataWrite = 0;
+}
+
+// miejsce na size bajtów za najnowszą klatką lub od początku bufora
+static bool findSpace(const ClipRecorder* r, size_t size, size_t* offset)
+{
+    const size_t capacity = r->data.size();
+    if(r->frameCount == 0)
+    {
+        *offset = 0;
+        return size <= capacity;
+    }
+    if(r->frameCount == r->frames.size())
+        return false;
+
+    const size_t oldest = r->frames[r->firstFrame].offset;
+    if(r->dataWrite > oldest)
+    {
+        // zajęte [oldest, dataWrite) - wolny koniec bufora albo początek
+        if(r->dataWrite + size <= capacity)
+        {
+            *offset = r->dataWrite;
+            return true;
+        }
+        if(size <= oldest)
+        {
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+    // zawinięte - wolne tylko [dataWrite, oldest)
+    if(r->dataWrite + size <= oldest)
+    {
+        *offset = r->dataWrite;
+        return true;
+    }
+    return false;
+}
+
+// ============ ZAPIS (wątek zapisu) ============
+
+static bool openClip(ClipRecorder* r)
+{
+    char name[64];
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    snprintf(name, sizeof(name), "/clip_%04d%02d%02d_%02d%02d%02d_%lu.avi",
+             local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+             local.tm_hour, local.tm_min, local.tm_sec, r->fileNumber++);
+    r->path = r->directory + name;
+
+    r->index.clear();
+    r->moviBytes = 0;
+    r->fileFailed = false;
+    r->file = fopen(r->path.c_str(), "wb");
+    if(!r->file)
+    {
+        r->fileFailed = true;
+        return false;
+    }
+    setvbuf(r->file, r->fileBuffer.data(), _IOFBF, r->fileBuffer.size());
+
+    unsigned char header[AVI_HEADER_SIZE];
+    writeAviHeader(header, r->params.width, r->params.height, r->params.fps);
+    if(fwrite(header, 1, sizeof(header), r->file) != sizeof(header))
+        r->fileFailed = true;
+    return true;
+}
+
+// klatka jako chunk '00dc' (wyrównany do 2 bajtów) w liście 'movi'
+static bool writeClipFrame(ClipRecorder* r, const unsigned char* jpeg, size_t size)
+{
+    if(!r->file || r->fileFailed)
+        return false;
+
+    unsigned char chunk[8];
+    putFourcc(chunk, "00dc");
+    put32(chunk + 4, (uint32_t)size);
+    static const unsigned char pad = 0;
+    bool ok = fwrite(chunk, 1, sizeof(chunk), r->file) == sizeof(chunk) &&
+              fwrite(jpeg, 1, size, r->file) == size &&
+              (size % 2 == 0 || fwrite(&pad, 1, 1, r->file) == 1);
+    if(!ok)
+    {
+        r->fileFailed = true;
+        return false;
+    }
+
+    AviIndexEntry entry = {r->moviBytes + 4, (uint32_t)size};
+    r->index.push_back(entry);
+    r->moviBytes += sizeof(chunk) + size + size % 2;
+    return true;
+}
+
+// indeks idx1 na końcu, potem jedyne zapisy poza kolejnością - liczniki w nagłówku
+static bool closeClip(ClipRecorder* r)
+{
+    if(!r->file)
+        return false;
+
+    bool ok = !r->fileFailed;
+    if(ok)
+    {
+        unsigned char chunk[16];
+        putFourcc(chunk, "idx1");
+        put32(chunk + 4, (uint32_t)(r->index.size() * 16));
+        ok = fwrite(chunk, 1, 8, r->file) == 8;
+        for(size_t i = 0; ok && i < r->index.size(); i++)
+        {
+            putFourcc(chunk, "00dc");
+            put32(chunk + 4, AVI_KEYFRAME);
+            put32(chunk + 8, r->index[i].offset);
+            put32(chunk + 12, r->index[i].size);
+            ok = fwrite(chunk, 1, 16, r->file) == 16;
+        }
+    }
+    if(ok)
+    {
+        const uint32_t frames = (uint32_t)r->index.size();
+        const uint32_t moviEnd = AVI_MOVI_START + 4 + r->moviBytes;
+        const uint32_t fileEnd = moviEnd + 8 + frames * 16;
+        const struct { long pos; uint32_t value; } patches[] = {
+            {AVI_RIFF_SIZE_POS, fileEnd - 8},
+            {AVI_TOTAL_FRAMES_POS, frames},
+            {AVI_STREAM_LENGTH_POS, frames},
+            {AVI_MOVI_SIZE_POS, moviEnd - AVI_MOVI_START},
+        };
+        for(const auto& patch : patches)
+        {
+            unsigned char value[4];
+            put32(value, patch.value);
+            ok = ok && fseek(r->file, patch.pos, SEEK_SET) == 0 &&
+                 fwrite(value, 1, 4, r->file) == 4;
+        }
+    }
+    if(fclose(r->file) != 0)
+        ok = false;
+    r->file = NULL;
+    return ok;
+}
+
+static void writerLoop(ClipRecorder* r)
+{
+    std::unique_lock<std::mutex> lock(r->mutex);
+    for(;;)
+    {
+        r->wake.wait(lock, [r] { return r->stopping || (r->recording && r->writeSeq < r->nextSeq); });
+
+        if(r->recording && r->writeSeq < r->nextSeq)
+        {
+            // klatka po końcu klipu zamyka plik (pojawi się w kolejnym tylko jako
+            // pre-roll, jeśli ruch wróci szybko)
+            const ClipFrame frame = frameAt(r, r->writeSeq);
+            bool endOfClip = frame.timeMs > r->clipEndMs;
+            bool split = r->file && r->index.size() >= r->maxClipFrames;
+            if(endOfClip)
+                r->recording = false;
+
+            lock.unlock();
+            bool closed = false, closeOk = true, openFailed = false, written = false;
+            if(r->file && (endOfClip || split))
+            {
+                closeOk = closeClip(r);
+                closed = true;
+            }
+            if(!endOfClip)
+            {
+                if(!r->file)
+                    openFailed = !openClip(r);
+                // bieżący klip nie zwalnia tej klatki - dane stabilne bez mutexu
+                written = writeClipFrame(r, r->data.data() + frame.offset, frame.size);
+            }
+            lock.lock();
+
+            if(closed && closeOk)
+            {
+                r->stats.clips++;
+                snprintf(r->stats.lastPath, sizeof(r->stats.lastPath), "%s", r->path.c_str());
+            }
+            else if(closed)
+            {
+                r->stats.writeErrors++;
+            }
+            if(openFailed)
+                r->stats.writeErrors++;
+            if(!endOfClip)
+            {
+                // nieudany zapis - klatka pominięta, reszta klipu i tak jest zapisywana dalej
+                if(written)
+                {
+                    r->stats.framesWritten++;
+                    r->stats.bytesWritten += frame.size;
+                }
+                else
+                {
+                    r->stats.framesDropped++;
+                }
+                r->writeSeq++;
+            }
+            continue;
+        }
+
+        // stopping - zaległości klipu są już zapisane
+        r->recording = false;
+        lock.unlock();
+        if(r->file)
+        {
+            bool ok = closeClip(r);
+            lock.lock();
+            if(ok)
+            {
+                r->stats.clips++;
+                snprintf(r->stats.lastPath, sizeof(r->stats.lastPath), "%s", r->path.c_str());
+            }
+            else
+            {
+                r->stats.writeErrors++;
+            }
+        }
+        return;
+    }
+}
+
+void* clip_recorder_init(ClipRecorderParams params)
+{
+    if(!params.directory || params.width <= 0 || params.height <= 0 || params.fps <= 0)
+        return NULL;
+    if(params.preSeconds < 0 || params.postSeconds < 0 || params.maxClipSeconds <= 0)
+        return NULL;
+    if(params.memoryLimit == 0)
+        return NULL;
+
+    ClipRecorder* r = new (std::nothrow) ClipRecorder();
+    if(!r)
+        return NULL;
+
+    r->params = params;
+    r->directory = params.directory;
+    r->params.directory = r->directory.c_str();
+    r->preMs = params.preSeconds * 1000LL;
+    r->postMs = params.postSeconds * 1000LL;
+    r->maxClipFrames = (size_t)params.maxClipSeconds * params.fps;
+
+    // opisów klatek tyle, ile zmieści pre-roll + post-roll z zapasem
+    r->data.resize(params.memoryLimit);
+    r->frames.resize((size_t)(params.preSeconds + params.postSeconds + 2) * params.fps);
+    r->firstFrame = 0;
+    r->frameCount = 0;
+    r->dataWrite = 0;
+    r->nextSeq = 0;
+
+    r->recording = false;
+    r->writeSeq = 0;
+    r->clipEndMs = 0;
+    r->stopping = false;
+    memset(&r->stats, 0, sizeof(r->stats));
+
+    r->file = NULL;
+    r->fileBuffer.resize(CLIP_WRITE_BUFFER);
+    r->index.reserve(r->maxClipFrames);
+    r->moviBytes = 0;
+    r->fileFailed = false;
+    r->fileNumber = 0;
+
+    r->writer = std::thread(writerLoop, r);
+    return r;
+}
+
+bool clip_recorder_push(void* recorder, const unsigned char* jpeg, size_t size, long long timestampMs)
+{
+    if(!recorder || !jpeg || size == 0)
+        return false;
+
+    ClipRecorder* r = static_cast<ClipRecorder*>(recorder);
+    std::lock_guard<std::mutex> lock(r->mutex);
+
+    // zwalnianie najstarszych klatek, dopóki nowa się nie zmieści
+    size_t offset = 0;
+    while(!findSpace(r, size, &offset))
+    {
+        if(!oldestEvictable(r))
+        {
+            r->stats.framesDropped++;
+            return false;
+        }
+        evictOldest(r);
+    }
+
+    memcpy(r->data.data() + offset, jpeg, size);
+    ClipFrame& frame = r->frames[(r->firstFrame + r->frameCount) % r->frames.size()];
+    frame.offset = offset;
+    frame.size = size;
+    frame.timeMs = timestampMs;
+    r->frameCount++;
+    r->nextSeq++;
+    r->dataWrite = offset + size;
+
+    // pre-roll: tylko ostatnie preSeconds (zapisane już klatki klipu też)
+    while(oldestEvictable(r) && timestampMs - frameAt(r, r->nextSeq - r->frameCount).timeMs > r->preMs)
+        evictOldest(r);
+
+    if(r->recording)
+        r->wake.notify_one();
+    return true;
+}
+
+void clip_recorder_trigger(void* recorder, long long timestampMs)
+{
+    if(!recorder)
+        return;
+
+    ClipRecorder* r = static_cast<ClipRecorder*>(recorder);
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        if(!r->recording)
+        {
+            // nowy klip od pre-rollu, bez klatek zapisanych już w poprzednim
+            unsigned long oldest = r->nextSeq - r->frameCount;
+            if(r->writeSeq < oldest)
+                r->writeSeq = oldest;
+            r->recording = true;
+            r->clipEndMs = timestampMs + r->postMs;
+        }
+        else if(timestampMs + r->postMs > r->clipEndMs)
+        {
+            r->clipEndMs = timestampMs + r->postMs;
+        }
+    }
+    r->wake.notify_one();
+}
+
+void clip_recorder_get_stats(void* recorder, ClipRecorderStats* stats)
+{
+    if(!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if(!recorder)
+        return;
+
+    ClipRecorder* r = static_cast<ClipRecorder*>(recorder);
+    std::lock_guard<std::mutex> lock(r->mutex);
+    *stats = r->stats;
+}
+
+void clip_recorder_destroy(void* recorder)
+{
+    if(!recorder)
+        return;
+
+    ClipRecorder* r = static_cast<ClipRecorder*>(recorder);
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        r->stopping = true;
+    }
+    r->wake.notify_one();
+    r->writer.join();
+    delete r;
+}
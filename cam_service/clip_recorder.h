@@ -0,0 +1,74 @@
+#ifndef CLIP_RECORDER_H
+#define CLIP_RECORDER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Nagrywanie klipów przy ruchu: ostatnie preSeconds klatek JPEG trzymane
+     * w buforze pierścieniowym o stałym rozmiarze (memoryLimit bajtów),
+     * po clip_recorder_trigger wątek zapisu zrzuca je do pliku AVI (MJPEG)
+     * razem z klatkami z kolejnych postSeconds. Każdy kolejny trigger
+     * przedłuża klip.
+     *
+     * Plik jest zapisywany sekwencyjnie przez duży bufor stdio - jedynie przy
+     * zamknięciu klipu dopisywany jest indeks i poprawiane są rozmiary w nagłówku.
+     * Gdy zapis nie nadąża i bufor jest pełny, nowe klatki są odrzucane
+     * (framesDropped) - przechwytywanie nigdy nie czeka na kartę SD.
+     */
+
+    typedef struct {
+        const char* directory;  // katalog na pliki clip_RRRRMMDD_GGMMSS_N.avi
+        int width;              // wymiary klatek (nagłówek AVI)
+        int height;
+        int fps;                // tempo podawania klatek do clip_recorder_push
+        int preSeconds;         // klatki sprzed ruchu
+        int postSeconds;        // klatki po ostatnim wykryciu ruchu
+        int maxClipSeconds;     // dłuższy ruch jest dzielony na kolejne pliki
+        size_t memoryLimit;     // bufor klatek w bajtach (pre-roll + zaległy zapis)
+    } ClipRecorderParams;
+
+    // Statystyki od init
+    typedef struct {
+        unsigned long clips;            // zamknięte pliki
+        unsigned long framesWritten;
+        unsigned long framesDropped;    // brak miejsca w buforze / za duża klatka
+        unsigned long writeErrors;      // nieudane otwarcie / zapis pliku
+        unsigned long long bytesWritten;
+        char lastPath[256];             // ostatnio zamknięty plik
+    } ClipRecorderStats;
+
+    /**
+     * Zwraca: wskaźnik do rejestratora (nieprzezroczysty) lub NULL przy złych parametrach
+     */
+    void* clip_recorder_init(ClipRecorderParams params);
+
+    /**
+     * Kopia klatki JPEG do bufora (dowolny wątek, bez I/O)
+     * @param timestampMs - czas monotoniczny klatki w ms
+     * @return false gdy klatka została odrzucona
+     */
+    bool clip_recorder_push(void* recorder, const unsigned char* jpeg, size_t size, long long timestampMs);
+
+    /**
+     * Ruch w chwili timestampMs: rozpoczęcie klipu (z pre-rollem) lub jego przedłużenie
+     */
+    void clip_recorder_trigger(void* recorder, long long timestampMs);
+
+    void clip_recorder_get_stats(void* recorder, ClipRecorderStats* stats);
+
+    /**
+     * Zatrzymanie wątku zapisu - zaległe klatki klipu są dopisywane, plik zamykany
+     */
+    void clip_recorder_destroy(void* recorder);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // CLIP_RECORDER_H
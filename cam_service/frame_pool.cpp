@@ -0,0 +1,144 @@
+#include "frame_pool.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+#define FRAME_POOL_ALIGN 64
+
+// slot publiczny musi być pierwszym polem - FrameSlot* <-> PoolSlot*
+struct PoolSlot {
+    FrameSlot frame;
+    alignas(FRAME_POOL_ALIGN) std::atomic<int> refs;   // 0 = wolny
+};
+
+struct FramePool {
+    int slotCount;
+    PoolSlot* slots;
+    unsigned char* memory;
+    std::atomic<int> nextSlot;          // od którego slotu zacząć szukanie
+    std::atomic<unsigned long> exhausted;
+};
+
+static inline size_t alignUp(size_t value)
+{
+    return (value + FRAME_POOL_ALIGN - 1) & ~(size_t)(FRAME_POOL_ALIGN - 1);
+}
+
+void* frame_pool_create(int slots, size_t slotSize, size_t headroom)
+{
+    if(slots < 1 || slotSize == 0)
+        return NULL;
+
+    FramePool* pool = new (std::nothrow) FramePool();
+    if(!pool)
+        return NULL;
+
+    // jeden blok, każda klatka od nowej linii cache; zapas przed klatką
+    // też zaokrąglony, żeby data pozostało wyrównane
+    const size_t pad = alignUp(headroom);
+    const size_t stride = pad + alignUp(slotSize);
+    pool->slotCount = slots;
+    pool->slots = new (std::nothrow) PoolSlot[slots];
+    pool->memory = (unsigned char*)aligned_alloc(FRAME_POOL_ALIGN, stride * slots);
+    if(!pool->slots || !pool->memory)
+    {
+        delete[] pool->slots;
+        free(pool->memory);
+        delete pool;
+        return NULL;
+    }
+
+    for(int i = 0; i < slots; i++)
+    {
+        PoolSlot& slot = pool->slots[i];
+        slot.frame.data = pool->memory + stride * i + pad;
+        slot.frame.size = 0;
+        slot.frame.timestampMs = 0;
+        slot.frame.capacity = slotSize;
+        slot.frame.headroom = pad;
+        slot.refs.store(0, std::memory_order_relaxed);
+    }
+    pool->nextSlot.store(0, std::memory_order_relaxed);
+    pool->exhausted.store(0, std::memory_order_relaxed);
+
+    return pool;
+}
+
+FrameSlot* frame_pool_acquire(void* pool)
+{
+    if(!pool)
+        return NULL;
+
+    FramePool* p = static_cast<FramePool*>(pool);
+    const int start = p->nextSlot.load(std::memory_order_relaxed);
+    for(int i = 0; i < p->slotCount; i++)
+    {
+        const int index = (start + i) % p->slotCount;
+        PoolSlot& slot = p->slots[index];
+        int expected = 0;
+        // acquire - widzimy wszystkie zapisy poprzedniego właściciela
+        if(slot.refs.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+        {
+            p->nextSlot.store((index + 1) % p->slotCount, std::memory_order_relaxed);
+            slot.frame.size = 0;
+            slot.frame.timestampMs = 0;
+            return &slot.frame;
+        }
+    }
+
+    p->exhausted.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+}
+
+void frame_slot_ref(FrameSlot* slot)
+{
+    if(!slot)
+        return;
+
+    reinterpret_cast<PoolSlot*>(slot)->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void frame_slot_unref(FrameSlot* slot)
+{
+    if(!slot)
+        return;
+
+    // release - zapisy do klatki są widoczne dla następnego właściciela
+    reinterpret_cast<PoolSlot*>(slot)->refs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+unsigned long frame_pool_exhausted(void* pool)
+{
+    if(!pool)
+        return 0;
+
+    FramePool* p = static_cast<FramePool*>(pool);
+    return p->exhausted.load(std::memory_order_relaxed);
+}
+
+int frame_pool_in_use(void* pool)
+{
+    if(!pool)
+        return 0;
+
+    FramePool* p = static_cast<FramePool*>(pool);
+    int inUse = 0;
+    for(int i = 0; i < p->slotCount; i++)
+    {
+        if(p->slots[i].refs.load(std::memory_order_relaxed) > 0)
+            inUse++;
+    }
+    return inUse;
+}
+
+void frame_pool_destroy(void* pool)
+{
+    if(!pool)
+        return;
+
+    FramePool* p = static_cast<FramePool*>(pool);
+    delete[] p->slots;
+    free(p->memory);
+    delete p;
+}
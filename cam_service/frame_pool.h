@@ -0,0 +1,66 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    // Klatka z puli - współdzielona przez wskaźnik (przechwytywanie, analiza,
+    // streaming, nagrywanie), zwracana do puli po ostatnim frame_slot_unref
+    typedef struct {
+        unsigned char* data;  // początek danych, wyrównany do linii cache (64 B)
+        size_t size;          // bajty klatki w data (ustawia piszący)
+        size_t capacity;      // maksymalny rozmiar klatki
+        size_t headroom;      // zapisywalne bajty przed data (np. LWS_PRE dla lws_write)
+        long long timestampMs; // czas przechwycenia (ustawia piszący, 0 = brak)
+    } FrameSlot;
+
+    /**
+     * Pula `slots` klatek po slotSize bajtów, alokowana jednorazowo.
+     * Przed każdą klatką rezerwowane jest co najmniej `headroom` bajtów,
+     * więc klatkę można wysłać przez lws_write bez kopiowania.
+     * Zwraca: wskaźnik do puli (nieprzezroczysty) lub NULL przy błędzie
+     */
+    void* frame_pool_create(int slots, size_t slotSize, size_t headroom);
+
+    /**
+     * Wolna klatka z licznikiem referencji 1 lub NULL gdy wszystkie są w użyciu
+     * (liczone w frame_pool_exhausted). Bez blokad i bez alokacji.
+     */
+    FrameSlot* frame_pool_acquire(void* pool);
+
+    /**
+     * Dodatkowa referencja (np. przekazanie klatki do innego wątku)
+     */
+    void frame_slot_ref(FrameSlot* slot);
+
+    /**
+     * Zwolnienie referencji; przy ostatniej klatka wraca do puli.
+     * Można wywołać z dowolnego wątku, slot == NULL jest ignorowany.
+     */
+    void frame_slot_unref(FrameSlot* slot);
+
+    /**
+     * Liczba nieudanych frame_pool_acquire od create
+     */
+    unsigned long frame_pool_exhausted(void* pool);
+
+    /**
+     * Liczba klatek aktualnie w użyciu (diagnostyka/testy)
+     */
+    int frame_pool_in_use(void* pool);
+
+    /**
+     * Zwolnienie puli - wszystkie klatki muszą być już zwrócone
+     */
+    void frame_pool_destroy(void* pool);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,182 @@
+#include "frame_ring.h"
+#include <atomic>
+#include <new>
+#include <vector>
+#include <string.h>
+
+// head - liczba opublikowanych klatek (pisze tylko producent),
+// tail - liczba zwolnionych klatek (pisze tylko konsument).
+// Liczniki rosną bez zawijania, slot = licznik % slots; head - tail <= slots.
+struct FrameRing {
+    int slots;
+    size_t slotSize;
+    std::vector<unsigned char> data;    // slots * slotSize
+    std::vector<size_t> sizes;          // rozmiar danych w slocie
+
+    // osobne linie cache - producent i konsument nie unieważniają sobie nawzajem
+    alignas(64) std::atomic<unsigned long> head;
+    std::atomic<unsigned long> dropped;
+    alignas(64) std::atomic<unsigned long> tail;
+    std::atomic<unsigned long> skipped;
+    unsigned long reading;              // klatka trzymana przez konsumenta
+    bool hasReading;
+};
+
+static inline unsigned char* slotData(FrameRing* ring, unsigned long index)
+{
+    return ring->data.data() + (index % ring->slots) * ring->slotSize;
+}
+
+void* frame_ring_create(int slots, size_t slotSize)
+{
+    // z jednym slotem producent nie miałby gdzie pisać podczas analizy
+    if(slots < 2 || slotSize == 0)
+        return NULL;
+
+    FrameRing* ring = new (std::nothrow) FrameRing();
+    if(!ring)
+        return NULL;
+
+    ring->slots = slots;
+    ring->slotSize = slotSize;
+    ring->data.resize((size_t)slots * slotSize);
+    ring->sizes.resize(slots, 0);
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->dropped.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->skipped.store(0, std::memory_order_relaxed);
+    ring->reading = 0;
+    ring->hasReading = false;
+
+    return ring;
+}
+
+unsigned char* frame_ring_begin_write(void* ring)
+{
+    if(!ring)
+        return NULL;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    unsigned long head = r->head.load(std::memory_order_relaxed);
+    unsigned long tail = r->tail.load(std::memory_order_acquire);
+    if(head - tail >= (unsigned long)r->slots)
+    {
+        r->dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    return slotData(r, head);
+}
+
+void frame_ring_commit_write(void* ring, size_t size)
+{
+    if(!ring)
+        return;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    unsigned long head = r->head.load(std::memory_order_relaxed);
+    r->sizes[head % r->slots] = size;
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+bool frame_ring_push(void* ring, const unsigned char* data, size_t size)
+{
+    if(!ring || !data)
+        return false;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    if(size > r->slotSize)
+    {
+        r->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    unsigned char* slot = frame_ring_begin_write(ring);
+    if(!slot)
+        return false;
+
+    memcpy(slot, data, size);
+    frame_ring_commit_write(ring, size);
+    return true;
+}
+
+// konsument: trzymanie klatki `index` do frame_ring_release
+static inline const unsigned char* acquireAt(FrameRing* r, unsigned long index, size_t* size)
+{
+    r->reading = index;
+    r->hasReading = true;
+    if(size)
+        *size = r->sizes[index % r->slots];
+    return slotData(r, index);
+}
+
+const unsigned char* frame_ring_acquire_latest(void* ring, size_t* size)
+{
+    if(!ring)
+        return NULL;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    unsigned long tail = r->tail.load(std::memory_order_relaxed);
+    unsigned long head = r->head.load(std::memory_order_acquire);
+    if(head == tail)
+        return NULL;
+
+    // starsze klatki od razu oddajemy producentowi
+    if(head - tail > 1)
+    {
+        r->skipped.fetch_add(head - tail - 1, std::memory_order_relaxed);
+        tail = head - 1;
+        r->tail.store(tail, std::memory_order_release);
+    }
+
+    return acquireAt(r, tail, size);
+}
+
+const unsigned char* frame_ring_acquire_next(void* ring, size_t* size)
+{
+    if(!ring)
+        return NULL;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    unsigned long tail = r->tail.load(std::memory_order_relaxed);
+    unsigned long head = r->head.load(std::memory_order_acquire);
+    if(head == tail)
+        return NULL;
+
+    return acquireAt(r, tail, size);
+}
+
+void frame_ring_release(void* ring)
+{
+    if(!ring)
+        return;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    if(!r->hasReading)
+        return;
+
+    r->hasReading = false;
+    r->tail.store(r->reading + 1, std::memory_order_release);
+}
+
+unsigned long frame_ring_dropped(void* ring)
+{
+    if(!ring)
+        return 0;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    return r->dropped.load(std::memory_order_relaxed);
+}
+
+unsigned long frame_ring_skipped(void* ring)
+{
+    if(!ring)
+        return 0;
+
+    FrameRing* r = static_cast<FrameRing*>(ring);
+    return r->skipped.load(std::memory_order_relaxed);
+}
+
+void frame_ring_destroy(void* ring)
+{
+    delete static_cast<FrameRing*>(ring);
+}
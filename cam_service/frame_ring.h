@@ -0,0 +1,83 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Bezblokadowy bufor pierścieniowy klatek: jeden producent (callback kamery),
+     * jeden konsument (wątek analizy). Sloty są alokowane raz w create,
+     * zapis i odczyt odbywają się bez kopiowania przez wskaźniki do slotów.
+     *
+     * Gdy pierścień jest pełny, producent nie czeka - klatka jest odrzucana
+     * i liczona w frame_ring_dropped.
+     */
+
+    /**
+     * Zwraca: wskaźnik do pierścienia (nieprzezroczysty) lub NULL
+     *         przy nieprawidłowych parametrach (slots < 2, slotSize == 0)
+     */
+    void* frame_ring_create(int slots, size_t slotSize);
+
+    /**
+     * Producent: wolny slot do zapisu (slotSize bajtów) lub NULL gdy pierścień
+     * jest pełny (klatka liczona jako odrzucona)
+     */
+    unsigned char* frame_ring_begin_write(void* ring);
+
+    /**
+     * Producent: publikacja slotu z frame_ring_begin_write z size bajtami danych
+     */
+    void frame_ring_commit_write(void* ring, size_t size);
+
+    /**
+     * Producent: kopia klatki do pierścienia (begin_write + memcpy + commit_write)
+     * @return false gdy klatka została odrzucona (pełny pierścień lub za duża)
+     */
+    bool frame_ring_push(void* ring, const unsigned char* data, size_t size);
+
+    /**
+     * Konsument: najnowsza opublikowana klatka. Starsze, nieodczytane klatki
+     * są pomijane (liczone w frame_ring_skipped) i od razu wracają do producenta.
+     * Klatka jest ważna do frame_ring_release.
+     *
+     * @return NULL gdy pierścień jest pusty
+     */
+    const unsigned char* frame_ring_acquire_latest(void* ring, size_t* size);
+
+    /**
+     * Konsument: najstarsza opublikowana klatka (kolejka FIFO, bez pomijania),
+     * np. gdy sloty przenoszą wskaźniki, które trzeba zwolnić.
+     * Klatka jest ważna do frame_ring_release.
+     *
+     * @return NULL gdy pierścień jest pusty
+     */
+    const unsigned char* frame_ring_acquire_next(void* ring, size_t* size);
+
+    /**
+     * Konsument: zwolnienie klatki z frame_ring_acquire_latest / frame_ring_acquire_next
+     */
+    void frame_ring_release(void* ring);
+
+    /**
+     * Klatki odrzucone przez producenta (pełny pierścień) od create
+     */
+    unsigned long frame_ring_dropped(void* ring);
+
+    /**
+     * Klatki pominięte przez konsumenta (nie najnowsze) od create
+     */
+    unsigned long frame_ring_skipped(void* ring);
+
+    void frame_ring_destroy(void* ring);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_RING_H
@@ -0,0 +1,97 @@
+#include "jpeg_encoder.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <new>
+#include <vector>
+#include <string.h>
+
+using namespace cv;
+
+struct JpegEncoderState {
+    int width;
+    int height;
+    std::vector<int> params;      // IMWRITE_JPEG_QUALITY, quality
+    Mat bgr;                      // klatka po konwersji z YUYV
+    std::vector<uchar> encoded;   // wyjście imencode - pojemność zostaje między klatkami
+    JpegEncoderStats stats;
+};
+
+static inline double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void* jpeg_encoder_init(int width, int height, int quality)
+{
+    if(width <= 0 || height <= 0 || quality < 1 || quality > 100)
+        return NULL;
+
+    JpegEncoderState* state = new (std::nothrow) JpegEncoderState();
+    if(!state)
+        return NULL;
+
+    state->width = width;
+    state->height = height;
+    state->params = {IMWRITE_JPEG_QUALITY, quality};
+    state->bgr.create(height, width, CV_8UC3);
+    // JPEG 4:2:0 w praktyce nie przekracza połowy rozmiaru YUYV
+    state->encoded.reserve((size_t)width * height);
+    memset(&state->stats, 0, sizeof(state->stats));
+
+    return state;
+}
+
+size_t jpeg_encoder_encode(void* encoder, const unsigned char* yuyv, size_t yuyvSize,
+                           unsigned char* out, size_t outCapacity)
+{
+    if(!encoder || !yuyv || !out)
+        return 0;
+
+    JpegEncoderState* state = static_cast<JpegEncoderState*>(encoder);
+    if(yuyvSize != (size_t)state->width * state->height * 2)
+    {
+        state->stats.failed++;
+        return 0;
+    }
+
+    double start = nowMs();
+
+    Mat frame(state->height, state->width, CV_8UC2, (void*)yuyv);
+    cvtColor(frame, state->bgr, COLOR_YUV2BGR_YUYV);
+
+    bool ok = imencode(".jpg", state->bgr, state->encoded, state->params);
+    if(!ok || state->encoded.size() > outCapacity)
+    {
+        state->stats.failed++;
+        return 0;
+    }
+    memcpy(out, state->encoded.data(), state->encoded.size());
+
+    double elapsed = nowMs() - start;
+    state->stats.frames++;
+    state->stats.lastMs = elapsed;
+    state->stats.totalMs += elapsed;
+    if(elapsed > state->stats.maxMs)
+        state->stats.maxMs = elapsed;
+    state->stats.lastBytes = state->encoded.size();
+
+    return state->encoded.size();
+}
+
+void jpeg_encoder_get_stats(void* encoder, JpegEncoderStats* stats)
+{
+    if(!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if(!encoder)
+        return;
+
+    JpegEncoderState* state = static_cast<JpegEncoderState*>(encoder);
+    *stats = state->stats;
+}
+
+void jpeg_encoder_destroy(void* encoder)
+{
+    delete static_cast<JpegEncoderState*>(encoder);
+}
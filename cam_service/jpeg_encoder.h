@@ -0,0 +1,43 @@
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    // Statystyki kodowania od init
+    typedef struct {
+        unsigned long frames;   // zakodowane klatki
+        unsigned long failed;   // klatki, które się nie zmieściły / błąd kodera
+        double lastMs;          // czas kodowania ostatniej klatki
+        double maxMs;
+        double totalMs;
+        size_t lastBytes;       // rozmiar ostatniego JPEG
+    } JpegEncoderStats;
+
+    /**
+     * Koder YUYV -> JPEG (cv::imencode) z buforami alokowanymi w init
+     * @param quality - jakość JPEG 1-100
+     * Zwraca: wskaźnik do kodera (nieprzezroczysty) lub NULL przy złych parametrach
+     */
+    void* jpeg_encoder_init(int width, int height, int quality);
+
+    /**
+     * Kodowanie klatki YUYV (width * height * 2 bajtów) do out
+     * @return rozmiar JPEG w bajtach lub 0 gdy się nie zmieścił w outCapacity / błąd
+     */
+    size_t jpeg_encoder_encode(void* encoder, const unsigned char* yuyv, size_t yuyvSize,
+                               unsigned char* out, size_t outCapacity);
+
+    void jpeg_encoder_get_stats(void* encoder, JpegEncoderStats* stats);
+
+    void jpeg_encoder_destroy(void* encoder);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // JPEG_ENCODER_H
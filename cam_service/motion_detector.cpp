@@ -1,22 +1,752 @@
 #include "motion_detector.h"
+#include "yuyv_luma.h"
+#include "box_blur.h"
+#include "stripe_pool.h"
 #include <opencv2/opencv.hpp>
 #include <vector>
+#include <chrono>
+#include <string.h>
 
 using namespace cv;
 
+// liczba przebiegów boxa przybliżających Gaussa
+#define BOX_BLUR_PASSES 3
+// pogrubienie maski: dwa przebiegi prostokąta 3x3 = okno 5x5
+#define DILATE_RADIUS 2
+// pętle Gaussa idą blokami o stałej długości - przy -O2 GCC wektoryzuje tylko
+// pętle, które nie potrzebują skalarnego ogona ani sprawdzania aliasów
+#define GAUSS_BLOCK 16
+
 // Wewnętrzna struktura stanu detektora
 struct MotionDetectorState {
     MotionParams params;
     int width;
     int height;
+    int workWidth;        // rozmiar obrazu analizy (po decymacji)
+    int workHeight;
+    int blurSize;         // kernel Gaussa przeliczony na rozdzielczość analizy
+    int boxRadius;        // promień boxa dla MOTION_BLUR_BOX
+    double minArea;       // minArea przeliczone na rozdzielczość analizy
+    YuyvLumaFn luma;      // kernel Y z YUYV wybrany wg możliwości CPU
+    std::vector<int> floodStack; // stos etykietowania plam (każdy piksel trafia raz)
+    std::vector<unsigned short> gaussKernel; // wagi Gaussa Q8 (suma 256), bez zerowych wag na końcach
+
+    // bufory robocze - alokowane raz w init, potem tylko używane
+    Mat lumaFrame;        // luminancja przed rozmyciem
+    Mat curBlurred;       // przetworzona (szara + rozmyta) bieżąca klatka
+    Mat prevBlurred;      // przetworzona (szara + rozmyta) poprzednia klatka
+    Mat tmpBlurred;       // poprzednia klatka dla motion_detector_detect
+    Mat frameDelta;
+    Mat thresh;
+    Mat dilated;          // maska po pogrubieniu (osobna - pasy czytają sąsiednie wiersze thresh)
+    Mat boxTmp;           // bufor pośredni rozmycia boxem
+    std::vector<unsigned int> boxColSums; // sumy kolumn boxa, workWidth na każdy pas
+    std::vector<unsigned short> gaussRows; // wiersz po przebiegu pionowym Gaussa, na każdy pas
+    std::vector<unsigned int> gaussSums; // sumy przebiegu poziomego Gaussa, workWidth na każdy pas
+    std::vector<uchar> dilateRows; // wiersz po przebiegu pionowym pogrubienia, na każdy pas
+    Mat background;       // model tła Q8.8 (tylko MOTION_MODE_BACKGROUND)
+    int backgroundShift;  // waga aktualizacji modelu = 2^-backgroundShift
+    size_t scratchAllocs; // realokacje buforów roboczych po init (hook testowy)
+    bool hasPrev;
+
+    // profilowanie etapów (benchmark)
+    bool profiling;
+    MotionStageTimes times;
+
+    // podział na pasy
+    StripePool* pool;
+    int stripeChanged[MOTION_MAX_THREADS];                     // zmienione piksele w pasie
+    unsigned short stripeTiles[MOTION_MAX_THREADS][MOTION_TILES_Y]; // kafelki pasa
+};
+
+// Zadanie dla jednego etapu potoku wykonywanego na pasach
+struct StripeJob {
+    MotionDetectorState* state;
+    const unsigned char* buffer;  // klatka YUYV (etap luminancji)
+    Mat* out;                     // wynik rozmycia
+    const Mat* prev;              // porównywane klatki (etap różnicy)
+    const Mat* cur;
+    int pass;                     // przebieg boxa
+    bool initBackground;          // etap różnicy: tylko inicjalizacja modelu tła
+    bool fuseThreshold;           // etap różnicy: od razu progowanie (bez osobnego etapu)
+    bool withTiles;               // etap pogrubienia: licz też kafelki
 };
 
+static inline void runStripes(MotionDetectorState* state, StripePool::StripeFn fn, StripeJob* job)
+{
+    state->pool->run(fn, job, state->workHeight);
+}
+
+static inline double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// początek pomiaru etapu (0 gdy profilowanie wyłączone)
+static inline double profStart(MotionDetectorState* state)
+{
+    return state->profiling ? nowMs() : 0.0;
+}
+
+// dolicza czas od start do sumy etapu i przesuwa start na teraz
+static inline void profStage(MotionDetectorState* state, double& total, double& start)
+{
+    if(!state->profiling)
+        return;
+    double now = nowMs();
+    total += now - start;
+    start = now;
+}
+
+// bufor roboczy o zadanym rozmiarze - realokacja tylko gdy rozmiar się nie zgadza
+static void ensureScratch(MotionDetectorState* state, Mat& m, int type)
+{
+    if(m.rows != state->workHeight || m.cols != state->workWidth || m.type() != type)
+    {
+        m.create(state->workHeight, state->workWidth, type);
+        state->scratchAllocs++;
+    }
+}
+
+// ============ ETAPY NA PASACH ============
+// Każdy etap przetwarza wiersze [rowBegin, rowEnd) obrazu analizy. Filtry czytają
+// też wiersze sąsiednich pasów z wejścia, więc wynik jest identyczny jak dla
+// całego obrazu - pod warunkiem, że poprzedni etap skończył się dla wszystkich
+// pasów. Etapy nie wołają filtrów OpenCV (te alokują przy każdym wywołaniu) -
+// bufory robocze, także wiersze pośrednie pasów, powstają w init.
+
+// wyciągnięcie (i ewentualnie decymacja) luminancji z YUYV
+static void stageLuma(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    (void)stripe;
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    MotionDetectorState* state = job->state;
+    const int scale = state->params.analysisScale;
+    const size_t srcStride = (size_t)state->width * 2;
+
+    state->luma(job->buffer + (size_t)rowBegin * scale * srcStride, srcStride,
+                state->lumaFrame.ptr(rowBegin), state->lumaFrame.step,
+                state->width, (rowEnd - rowBegin) * scale);
+}
+
+// indeks z odbiciem bez powtórzenia brzegu (jak BORDER_REFLECT_101 w OpenCV)
+static inline int reflect101(int i, int n)
+{
+    if(n == 1)
+        return 0;
+    while(i < 0 || i >= n)
+        i = i < 0 ? -i : 2 * (n - 1) - i;
+    return i;
+}
+
+// sum += weight * src dla całego wiersza (przebieg pionowy Gaussa)
+static inline void gaussAddRow(unsigned short* __restrict sum, const uchar* __restrict src,
+                               unsigned short weight, int w)
+{
+    int x = 0;
+    for(; x + GAUSS_BLOCK <= w; x += GAUSS_BLOCK)
+    {
+        for(int j = 0; j < GAUSS_BLOCK; j++)
+            sum[x + j] = (unsigned short)(sum[x + j] + weight * src[x + j]);
+    }
+    for(; x < w; x++)
+        sum[x] = (unsigned short)(sum[x] + weight * src[x]);
+}
+
+// to samo w 32 bitach (przebieg poziomy - src to wiersz przesunięty o tap)
+static inline void gaussAddRowWide(unsigned int* __restrict sum, const unsigned short* __restrict src,
+                                   unsigned int weight, int w)
+{
+    int x = 0;
+    for(; x + GAUSS_BLOCK <= w; x += GAUSS_BLOCK)
+    {
+        for(int j = 0; j < GAUSS_BLOCK; j++)
+            sum[x + j] += weight * src[x + j];
+    }
+    for(; x < w; x++)
+        sum[x] += weight * src[x];
+}
+
+// sumy Q16 (dwa przebiegi wag Q8) z zaokrągleniem do 8 bitów
+static inline void gaussStoreRow(uchar* __restrict dst, const unsigned int* __restrict sum, int w)
+{
+    int x = 0;
+    for(; x + GAUSS_BLOCK <= w; x += GAUSS_BLOCK)
+    {
+        for(int j = 0; j < GAUSS_BLOCK; j++)
+            dst[x + j] = (uchar)((sum[x + j] + (1u << 15)) >> 16);
+    }
+    for(; x < w; x++)
+        dst[x] = (uchar)((sum[x] + (1u << 15)) >> 16);
+}
+
+// Gauss rozdzielny w stałym przecinku (wagi Q8) - własna implementacja zamiast
+// cv::GaussianBlur, które przy każdym wywołaniu alokuje kernel i filtr.
+// Najpierw pionowo do wiersza pasa, potem poziomo do out, więc pas czyta
+// tylko lumaFrame (gotowe w całości) i nie zależy od sąsiednich pasów.
+// Oba przebiegi to ważone sumy całych (przesuniętych) wierszy.
+static void stageGauss(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    MotionDetectorState* state = job->state;
+    const int w = state->workWidth;
+    const int h = state->workHeight;
+    const int r = (int)state->gaussKernel.size() / 2;
+    const unsigned short* k = state->gaussKernel.data();
+    // wiersz z marginesem r po obu stronach na odbite brzegi
+    unsigned short* mid = &state->gaussRows[(size_t)stripe * (w + 2 * r)] + r;
+    unsigned int* sums = &state->gaussSums[(size_t)stripe * w];
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        // max 255 * 256 - mieści się w 16 bitach
+        memset(mid, 0, w * sizeof(*mid));
+        for(int i = -r; i <= r; i++)
+            gaussAddRow(mid, state->lumaFrame.ptr<uchar>(reflect101(y + i, h)), k[i + r], w);
+        for(int i = 1; i <= r; i++)
+        {
+            mid[-i] = mid[reflect101(-i, w)];
+            mid[w - 1 + i] = mid[reflect101(w - 1 + i, w)];
+        }
+
+        memset(sums, 0, w * sizeof(*sums));
+        for(int i = -r; i <= r; i++)
+            gaussAddRowWide(sums, mid + i, k[i + r], w);
+        gaussStoreRow(job->out->ptr<uchar>(y), sums, w);
+    }
+}
+
+static void stageBoxRows(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    (void)stripe;
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    MotionDetectorState* state = job->state;
+    const Mat& in = job->pass == 0 ? state->lumaFrame : *job->out;
+
+    box_blur_rows_u8(in.data, in.step, state->boxTmp.data, state->boxTmp.step,
+                     state->workWidth, rowBegin, rowEnd, state->boxRadius);
+}
+
+static void stageBoxCols(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    MotionDetectorState* state = job->state;
+
+    box_blur_cols_u8(state->boxTmp.data, state->boxTmp.step, job->out->data, job->out->step,
+                     state->workWidth, state->workHeight, rowBegin, rowEnd, state->boxRadius,
+                     &state->boxColSums[(size_t)stripe * state->workWidth]);
+}
+
+// Model tła: średnia krocząca w stałym przecinku (Q8.8 w CV_16UC1).
+// Jednym przebiegiem liczy różnicę klatki od modelu do frameDelta
+// i aktualizuje model: bg += (cur - bg) * 2^-backgroundShift
+static void diffAndUpdateBackground(MotionDetectorState* state, const Mat& gray, int rowBegin, int rowEnd)
+{
+    const int shift = state->backgroundShift;
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const uchar* cur = gray.ptr<uchar>(y);
+        unsigned short* bg = state->background.ptr<unsigned short>(y);
+        uchar* delta = state->frameDelta.ptr<uchar>(y);
+        for(int x = 0; x < gray.cols; x++)
+        {
+            int model = (bg[x] + 128) >> 8;
+            int d = cur[x] - model;
+            delta[x] = (uchar)(d < 0 ? -d : d);
+            int target = cur[x] << 8;
+            bg[x] = (unsigned short)(bg[x] + ((target - bg[x]) >> shift));
+        }
+    }
+}
+
+// model tła = bieżąca klatka
+static void initBackground(MotionDetectorState* state, const Mat& gray, int rowBegin, int rowEnd)
+{
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const uchar* cur = gray.ptr<uchar>(y);
+        unsigned short* bg = state->background.ptr<unsigned short>(y);
+        for(int x = 0; x < gray.cols; x++)
+        {
+            bg[x] = (unsigned short)(cur[x] << 8);
+        }
+    }
+}
+
+// frameDelta > motionThreshold -> 255 w thresh (THRESH_BINARY); cv::threshold
+// rozdziela duże obrazy na parallel_for_, który alokuje zadanie przy każdym wywołaniu
+static void thresholdRows(MotionDetectorState* state, int rowBegin, int rowEnd)
+{
+    const int limit = state->params.motionThreshold;
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const uchar* delta = state->frameDelta.ptr<uchar>(y);
+        uchar* out = state->thresh.ptr<uchar>(y);
+        for(int x = 0; x < state->workWidth; x++)
+            out[x] = delta[x] > limit ? 255 : 0;
+    }
+}
+
+// różnica (z poprzednią klatką lub modelem tła) i progowanie
+static void stageDiff(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    (void)stripe;
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    MotionDetectorState* state = job->state;
+
+    if(job->initBackground)
+    {
+        initBackground(state, *job->cur, rowBegin, rowEnd);
+        return;
+    }
+
+    if(job->prev)
+    {
+        for(int y = rowBegin; y < rowEnd; y++)
+        {
+            const uchar* a = job->prev->ptr<uchar>(y);
+            const uchar* b = job->cur->ptr<uchar>(y);
+            uchar* delta = state->frameDelta.ptr<uchar>(y);
+            for(int x = 0; x < state->workWidth; x++)
+            {
+                int d = a[x] - b[x];
+                delta[x] = (uchar)(d < 0 ? -d : d);
+            }
+        }
+    }
+    else
+    {
+        diffAndUpdateBackground(state, *job->cur, rowBegin, rowEnd);
+    }
+
+    if(job->fuseThreshold)
+        thresholdRows(state, rowBegin, rowEnd);
+}
+
+// progowanie jako osobny etap (tylko przy profilowaniu)
+static void stageThreshold(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    (void)stripe;
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    thresholdRows(job->state, rowBegin, rowEnd);
+}
+
+// liczba zmienionych pikseli w wierszach + bitmapa kafelków, w których coś się zmieniło
+static int countChangedRows(const Mat& mask, int rowBegin, int rowEnd, unsigned short* tiles)
+{
+    const int w = mask.cols;
+    const int h = mask.rows;
+    int changed = 0;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const uchar* row = mask.ptr<uchar>(y);
+        unsigned short* tileRow = &tiles[y * MOTION_TILES_Y / h];
+        for(int x = 0; x < w; x++)
+        {
+            if(row[x])
+            {
+                changed++;
+                *tileRow |= (unsigned short)(1u << (x * MOTION_TILES_X / w));
+            }
+        }
+    }
+    return changed;
+}
+
+// Pogrubienie + zliczenie zmienionych pikseli w pasie. Dwa przebiegi prostokąta
+// 3x3 to maksimum z okna 5x5 obciętego do obrazu (jak cv::dilate z brzegiem
+// stałym, który nie alokuje filtra przy każdym wywołaniu) - pionowo do wiersza
+// pasa, potem poziomo; pas czyta tylko thresh, gotowe w całości.
+static void stageDilate(void* ctx, int stripe, int rowBegin, int rowEnd)
+{
+    StripeJob* job = static_cast<StripeJob*>(ctx);
+    MotionDetectorState* state = job->state;
+    const int w = state->workWidth;
+    const int h = state->workHeight;
+    const int r = DILATE_RADIUS;
+    uchar* colMax = &state->dilateRows[(size_t)stripe * w];
+    int changed = 0;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const int y0 = y - r < 0 ? 0 : y - r;
+        const int y1 = y + r >= h ? h - 1 : y + r;
+        memcpy(colMax, state->thresh.ptr<uchar>(y0), w);
+        for(int yy = y0 + 1; yy <= y1; yy++)
+        {
+            const uchar* src = state->thresh.ptr<uchar>(yy);
+            for(int x = 0; x < w; x++)
+                colMax[x] = colMax[x] > src[x] ? colMax[x] : src[x];
+        }
+
+        uchar* dst = state->dilated.ptr<uchar>(y);
+        for(int x = 0; x < w; x++)
+        {
+            const int x0 = x - r < 0 ? 0 : x - r;
+            const int x1 = x + r >= w ? w - 1 : x + r;
+            uchar m = 0;
+            for(int i = x0; i <= x1; i++)
+                m = colMax[i] > m ? colMax[i] : m;
+            dst[x] = m;
+            changed += m != 0;
+        }
+    }
+
+    if(job->withTiles)
+    {
+        memset(state->stripeTiles[stripe], 0, sizeof(state->stripeTiles[stripe]));
+        changed = countChangedRows(state->dilated, rowBegin, rowEnd, state->stripeTiles[stripe]);
+    }
+    state->stripeChanged[stripe] = changed;
+}
+
+// flaga imdecode dekodująca samą luminancję w skali 1/scale (skalowanie DCT w libjpeg)
+static int reducedGrayFlag(int scale)
+{
+    switch(scale)
+    {
+    case 2: return IMREAD_REDUCED_GRAYSCALE_2;
+    case 4: return IMREAD_REDUCED_GRAYSCALE_4;
+    case 8: return IMREAD_REDUCED_GRAYSCALE_8;
+    default: return IMREAD_GRAYSCALE;
+    }
+}
+
+// JPEG -> lumaFrame; false gdy dane są uszkodzone lub klatka ma inny rozmiar niż przy init
+static bool decodeJpegLuma(MotionDetectorState* state, const unsigned char* buffer, size_t size)
+{
+    const Mat encoded(1, (int)size, CV_8UC1, (void*)buffer);
+    // przy nieczytelnym nagłówku imdecode nie rusza lumaFrame - została w nim
+    // poprzednia klatka o poprawnym rozmiarze, więc liczy się tylko wynik
+    Mat decoded = imdecode(encoded, reducedGrayFlag(state->params.analysisScale), &state->lumaFrame);
+    if(decoded.empty())
+    {
+        fprintf(stderr, "[MotionDetector] Zły JPEG: dekodowanie nie powiodło się (%zu B)\n", size);
+        return false;
+    }
+
+    if(state->lumaFrame.rows != state->workHeight || state->lumaFrame.cols != state->workWidth)
+    {
+        fprintf(stderr, "[MotionDetector] Zły JPEG: %dx%d po dekodowaniu, oczekiwano %dx%d\n",
+                state->lumaFrame.cols, state->lumaFrame.rows, state->workWidth, state->workHeight);
+        ensureScratch(state, state->lumaFrame, CV_8UC1);
+        return false;
+    }
+    return true;
+}
+
+// luminancja + rozmycie klatki (YUYV lub JPEG, size bajtów) do out
+static bool prepareFrame(MotionDetectorState* state, const unsigned char* buffer, size_t size, Mat& out)
+{
+    ensureScratch(state, state->lumaFrame, CV_8UC1);
+    ensureScratch(state, out, CV_8UC1);
+
+    StripeJob job = {};
+    job.state = state;
+    job.buffer = buffer;
+    job.out = &out;
+
+    double t = profStart(state);
+    if(state->params.input == MOTION_INPUT_MJPEG)
+    {
+        if(!decodeJpegLuma(state, buffer, size))
+            return false;
+    }
+    else
+    {
+        runStripes(state, stageLuma, &job);
+    }
+    profStage(state, state->times.lumaMs, t);
+
+    if(state->params.blur == MOTION_BLUR_BOX)
+    {
+        ensureScratch(state, state->boxTmp, CV_8UC1);
+        for(job.pass = 0; job.pass < BOX_BLUR_PASSES; job.pass++)
+        {
+            runStripes(state, stageBoxRows, &job);
+            runStripes(state, stageBoxCols, &job);
+        }
+    }
+    else
+    {
+        runStripes(state, stageGauss, &job);
+    }
+    profStage(state, state->times.blurMs, t);
+    return true;
+}
+
+// walidacja rozmiaru wejścia - YUYV = width * height * 2, JPEG dowolny niepusty
+static bool validFrameSize(MotionDetectorState* state, size_t size)
+{
+    if(state->params.input == MOTION_INPUT_MJPEG)
+        return size > 0;
+    return size == (size_t)(state->width * state->height * 2);
+}
+
+// wstawia ramkę do listy posortowanej malejąco po powierzchni (max MOTION_MAX_BOXES)
+static void insertBox(MotionResult* result, const MotionBox& box)
+{
+    int pos = result->boxCount;
+    while(pos > 0 && result->boxes[pos - 1].area < box.area)
+        pos--;
+    if(pos >= MOTION_MAX_BOXES)
+        return;
+
+    int last = result->boxCount < MOTION_MAX_BOXES ? result->boxCount : MOTION_MAX_BOXES - 1;
+    for(int i = last; i > pos; i--)
+        result->boxes[i] = result->boxes[i - 1];
+    result->boxes[pos] = box;
+    if(result->boxCount < MOTION_MAX_BOXES)
+        result->boxCount++;
+}
+
+// Szuka 8-spójnych plam o powierzchni (w pikselach) większej niż minArea.
+// Bez result kończy przy pierwszej takiej plamie; z result przechodzi cały obraz
+// i zbiera ramki największych plam (we współrzędnych pełnej rozdzielczości).
+// Odwiedzone piksele są zerowane w mask.
+static bool findBlobs(Mat& mask, double minArea, std::vector<int>& stack, int scale, MotionResult* result)
+{
+    const int w = mask.cols;
+    const int h = mask.rows;
+    const size_t step = mask.step;
+    uchar* data = mask.data;
+    bool found = false;
+
+    for(int y = 0; y < h; y++)
+    {
+        uchar* row = data + y * step;
+        for(int x = 0; x < w; x++)
+        {
+            if(!row[x])
+                continue;
+
+            // flood fill ze stosem indeksów (y * w + x)
+            int area = 0;
+            int minX = x, maxX = x, minY = y, maxY = y;
+            stack.clear();
+            stack.push_back(y * w + x);
+            row[x] = 0;
+            while(!stack.empty())
+            {
+                int idx = stack.back();
+                stack.pop_back();
+                area++;
+                if(!result && area > minArea)
+                    return true;
+
+                int py = idx / w;
+                int px = idx % w;
+                if(px < minX) minX = px;
+                if(px > maxX) maxX = px;
+                if(py < minY) minY = py;
+                if(py > maxY) maxY = py;
+                for(int ny = py - 1; ny <= py + 1; ny++)
+                {
+                    if(ny < 0 || ny >= h)
+                        continue;
+                    uchar* nrow = data + ny * step;
+                    for(int nx = px - 1; nx <= px + 1; nx++)
+                    {
+                        if(nx < 0 || nx >= w || !nrow[nx])
+                            continue;
+                        nrow[nx] = 0;
+                        stack.push_back(ny * w + nx);
+                    }
+                }
+            }
+
+            if(result && area > minArea)
+            {
+                found = true;
+                MotionBox box;
+                box.x = minX * scale;
+                box.y = minY * scale;
+                box.width = (maxX - minX + 1) * scale;
+                box.height = (maxY - minY + 1) * scale;
+                box.area = area * scale * scale;
+                insertBox(result, box);
+            }
+        }
+    }
+    return found;
+}
+
+// porównanie bieżącej klatki z poprzednią (prev) lub z modelem tła (prev == NULL);
+// result (opcjonalny) dostaje pełny opis ruchu
+static bool compareFrames(MotionDetectorState* state, const Mat* prev, const Mat& cur,
+                          MotionResult* result)
+{
+    ensureScratch(state, state->frameDelta, CV_8UC1);
+    ensureScratch(state, state->thresh, CV_8UC1);
+    ensureScratch(state, state->dilated, CV_8UC1);
+
+    StripeJob job = {};
+    job.state = state;
+    job.prev = prev;
+    job.cur = &cur;
+    job.withTiles = result != NULL;
+
+    // różnica + progowanie, potem pogrubienie (czyta sąsiednie wiersze thresh);
+    // przy profilowaniu progowanie jest osobnym etapem, żeby zmierzyć je oddzielnie
+    double t = profStart(state);
+    job.fuseThreshold = !state->profiling;
+    runStripes(state, stageDiff, &job);
+    profStage(state, state->times.diffMs, t);
+    if(!job.fuseThreshold)
+    {
+        runStripes(state, stageThreshold, &job);
+        profStage(state, state->times.thresholdMs, t);
+    }
+    runStripes(state, stageDilate, &job);
+    profStage(state, state->times.dilateMs, t);
+
+    // scalenie wyników pasów
+    int changed = 0;
+    for(int i = 0; i < state->pool->stripes(); i++)
+    {
+        changed += state->stripeChanged[i];
+        if(result)
+        {
+            for(int tile = 0; tile < MOTION_TILES_Y; tile++)
+                result->tiles[tile] |= state->stripeTiles[i][tile];
+        }
+    }
+
+    const int scale = state->params.analysisScale;
+    if(result)
+    {
+        result->changedArea = changed * scale * scale;
+        result->score = (float)changed / (float)(state->workWidth * state->workHeight);
+    }
+
+    // szybki test: za mało zmienionych pikseli w całym obrazie
+    if(changed <= state->minArea)
+        return false;
+
+    // plamy mogą przechodzić przez granice pasów - etykietowanie na całej masce
+    size_t stackCapacity = state->floodStack.capacity();
+    bool found = findBlobs(state->dilated, state->minArea, state->floodStack, scale, result);
+    if(state->floodStack.capacity() != stackCapacity)
+        state->scratchAllocs++;
+    profStage(state, state->times.blobsMs, t);
+
+    if(result)
+        result->motion = found;
+    return found;
+}
+
+// wagi Gaussa (sigma jak w OpenCV dla sigma = 0) zaokrąglone do Q8; resztę
+// zaokrągleń dostaje środek, żeby suma była dokładnie 256. Skrajne wagi
+// zaokrąglone do 0 (np. dla ksize 21) są odcinane - wynik ten sam, mniej tapów
+static void initGaussKernel(MotionDetectorState* state)
+{
+    const int size = state->blurSize;
+    Mat kernel = getGaussianKernel(size, 0, CV_64F);
+    std::vector<unsigned short>& k = state->gaussKernel;
+    k.resize(size);
+    int sum = 0;
+    for(int i = 0; i < size; i++)
+    {
+        k[i] = (unsigned short)cvRound(kernel.at<double>(i) * 256.0);
+        sum += k[i];
+    }
+    k[size / 2] = (unsigned short)(k[size / 2] + 256 - sum);
+
+    int trim = 0;
+    while(trim < size / 2 && k[trim] == 0 && k[size - 1 - trim] == 0)
+        trim++;
+    k.erase(k.end() - trim, k.end());
+    k.erase(k.begin(), k.begin() + trim);
+}
+
 void* motion_detector_init(int width, int height, MotionParams params)
 {
+    int scale = params.analysisScale > 0 ? params.analysisScale : 1;
+    YuyvLumaIsa isa = YUYV_LUMA_SCALAR;
+    YuyvLumaFn luma = NULL;
+    if(params.input == MOTION_INPUT_MJPEG)
+    {
+        // skalowanie DCT libjpeg: 1/1, 1/2, 1/4, 1/8
+        if(scale != 1 && scale != 2 && scale != 4 && scale != 8)
+        {
+            fprintf(stderr, "[MotionDetector] Nieobsługiwane analysisScale=%d dla MJPEG (dozwolone 1, 2, 4, 8)\n",
+                    params.analysisScale);
+            return NULL;
+        }
+    }
+    else
+    {
+        luma = yuyv_luma_select(scale, &isa);
+        if(!luma)
+        {
+            fprintf(stderr, "[MotionDetector] Nieobsługiwane analysisScale=%d (dozwolone 1, 2, 4)\n",
+                    params.analysisScale);
+            return NULL;
+        }
+    }
+
+    // pas musi mieć sensowną liczbę wierszy
+    int threads = params.threads > 0 ? params.threads : 1;
+    if(threads > MOTION_MAX_THREADS)
+        threads = MOTION_MAX_THREADS;
+    while(threads > 1 && (height / scale) / threads < 16)
+        threads--;
+
     MotionDetectorState* state = new MotionDetectorState();
     state->width = width;
     state->height = height;
     state->params = params;
+    state->params.analysisScale = scale;
+    state->params.threads = threads;
+    state->pool = new StripePool(threads);
+    state->workWidth = width / scale;
+    state->workHeight = height / scale;
+    state->hasPrev = false;
+    state->luma = luma;
+    state->floodStack.reserve((size_t)state->workWidth * state->workHeight);
+
+    // wszystkie bufory robocze i kernel pogrubienia tworzone raz
+    state->lumaFrame.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->curBlurred.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->prevBlurred.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->tmpBlurred.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->frameDelta.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->thresh.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->dilated.create(state->workHeight, state->workWidth, CV_8UC1);
+    state->dilateRows.resize((size_t)state->workWidth * threads);
+    if(params.blur == MOTION_BLUR_BOX)
+    {
+        state->boxTmp.create(state->workHeight, state->workWidth, CV_8UC1);
+        state->boxColSums.resize((size_t)state->workWidth * threads);
+    }
+    if(params.mode == MOTION_MODE_BACKGROUND)
+    {
+        state->background.create(state->workHeight, state->workWidth, CV_16UC1);
+    }
+    state->scratchAllocs = 0;
+    state->profiling = false;
+    memset(&state->times, 0, sizeof(state->times));
+
+    // blur i minArea zadane dla pełnej rozdzielczości - przeliczamy na obraz analizy
+    state->blurSize = (params.gaussBlur / scale) | 1;
+    if(state->blurSize < 3)
+        state->blurSize = 3;
+    state->boxRadius = box_blur_radius_for_gauss(state->blurSize, BOX_BLUR_PASSES);
+    if(params.blur != MOTION_BLUR_BOX)
+    {
+        initGaussKernel(state);
+        const int gaussRadius = (int)state->gaussKernel.size() / 2;
+        state->gaussRows.resize((size_t)(state->workWidth + 2 * gaussRadius) * threads);
+        state->gaussSums.resize((size_t)state->workWidth * threads);
+    }
+    state->minArea = (double)params.minArea / (scale * scale);
+    state->backgroundShift = params.backgroundShift > 0 ? params.backgroundShift : 4;
+
+    fprintf(stderr, "[MotionDetector] Analiza %dx%d, kernel luminancji: %s, wątki: %d\n",
+            state->workWidth, state->workHeight,
+            params.input == MOTION_INPUT_MJPEG ? "jpeg" : yuyv_luma_isa_name(isa), threads);
     return state;
 }
 
@@ -24,6 +754,17 @@ bool motion_detector_detect(void* detector,
     const unsigned char* currentBuffer, size_t currentSize,
     const unsigned char* prevBuffer, size_t prevSize)
 {
+    return motion_detector_detect_ex(detector, currentBuffer, currentSize, prevBuffer, prevSize, NULL);
+}
+
+bool motion_detector_detect_ex(void* detector,
+    const unsigned char* currentBuffer, size_t currentSize,
+    const unsigned char* prevBuffer, size_t prevSize,
+    MotionResult* result)
+{
+    if(result)
+        memset(result, 0, sizeof(*result));
+
     if(!detector || !currentBuffer || currentSize == 0)
         return false;
 
@@ -32,62 +773,141 @@ bool motion_detector_detect(void* detector,
     if (!prevBuffer || prevSize == 0)
         return false;
 
-    // walidacja rozmiaru - YUYV = width * height * 2
-    size_t expectedSize = (size_t)(state->width * state->height * 2);
-    if(currentSize != expectedSize || prevSize != expectedSize)
+    if(!validFrameSize(state, currentSize) || !validFrameSize(state, prevSize))
     {
         fprintf(stderr, "[MotionDetector] Zły rozmiar YUYV: current=%zu prev=%zu oczekiwano=%zu\n",
-                currentSize, prevSize, expectedSize);
+                currentSize, prevSize, (size_t)(state->width * state->height * 2));
         return false;
     }
 
-    Mat currentFrame(state->height, state->width, CV_8UC2, (void*)currentBuffer);
-    Mat prevFrame   (state->height, state->width, CV_8UC2, (void*)prevBuffer);
+    if(state->profiling)
+        state->times.calls++;
 
-    // konwersja do skali szarości
-    Mat gray, prevGray;
-    cvtColor(currentFrame, gray, COLOR_YUV2GRAY_YUYV);
-    cvtColor(prevFrame, prevGray, COLOR_YUV2GRAY_YUYV);
+    // nie ruszamy prevBlurred - strumień push_frame pozostaje nienaruszony
+    if(!prepareFrame(state, currentBuffer, currentSize, state->curBlurred) ||
+       !prepareFrame(state, prevBuffer, prevSize, state->tmpBlurred))
+        return false;
 
-    // rozmycie gaussa
-    GaussianBlur(gray, gray, Size(state->params.gaussBlur, state->params.gaussBlur), 0);
-    GaussianBlur(prevGray, prevGray, Size(state->params.gaussBlur, state->params.gaussBlur), 0);
+    return compareFrames(state, &state->tmpBlurred, state->curBlurred, result);
+}
 
-    // różnica klatek
-    Mat frameDelta;
-    absdiff(prevGray, gray, frameDelta);
+bool motion_detector_push_frame(void* detector, const unsigned char* frameBuffer, size_t frameSize)
+{
+    return motion_detector_push_frame_ex(detector, frameBuffer, frameSize, NULL);
+}
 
-    // progowanie
-    Mat thresh;
-    threshold(frameDelta, thresh, state->params.motionThreshold, 255, THRESH_BINARY);
+bool motion_detector_push_frame_ex(void* detector, const unsigned char* frameBuffer, size_t frameSize,
+                                   MotionResult* result)
+{
+    if(result)
+        memset(result, 0, sizeof(*result));
 
-    // pogrubienie
-    Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
-    dilate(thresh, thresh, kernel, Point(-1, -1), 2);
+    if(!detector || !frameBuffer || frameSize == 0)
+        return false;
 
-    // znajdowanie konturów
-    std::vector<std::vector<Point>> contours;
-    findContours(thresh, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+    MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
 
-    bool motionFound = false;
-    for(size_t i = 0; i < contours.size(); i++)
+    if(!validFrameSize(state, frameSize))
     {
-        double area = contourArea(contours[i]);
-        if(area > state->params.minArea)
+        fprintf(stderr, "[MotionDetector] Zły rozmiar YUYV: frame=%zu oczekiwano=%zu\n",
+                frameSize, (size_t)(state->width * state->height * 2));
+        return false;
+    }
+
+    if(state->profiling)
+        state->times.calls++;
+
+    // przetwarzamy tylko nową klatkę - poprzednia jest już w stanie;
+    // uszkodzony JPEG nie zmienia stanu
+    if(!prepareFrame(state, frameBuffer, frameSize, state->curBlurred))
+        return false;
+
+    if(state->params.mode == MOTION_MODE_BACKGROUND)
+    {
+        bool motionFound = false;
+        if(state->hasPrev)
+        {
+            motionFound = compareFrames(state, NULL, state->curBlurred, result);
+        }
+        else
         {
-            motionFound = true;
-            break;
+            StripeJob job = {};
+            job.state = state;
+            job.cur = &state->curBlurred;
+            job.initBackground = true;
+            runStripes(state, stageDiff, &job);
         }
+        state->hasPrev = true;
+        return motionFound;
     }
 
+    bool motionFound = false;
+    if(state->hasPrev)
+    {
+        motionFound = compareFrames(state, &state->prevBlurred, state->curBlurred, result);
+    }
+
+    // bieżąca staje się poprzednią - zamiana nagłówków, bez kopiowania danych
+    cv::swap(state->prevBlurred, state->curBlurred);
+    state->hasPrev = true;
+
     return motionFound;
 }
 
+void motion_detector_reset(void* detector)
+{
+    if(!detector)
+        return;
+
+    MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
+    state->hasPrev = false;
+}
+
+size_t motion_detector_alloc_count(void* detector)
+{
+    if(!detector)
+        return 0;
+
+    MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
+    return state->scratchAllocs;
+}
+
+void motion_detector_set_profiling(void* detector, bool enabled)
+{
+    if(!detector)
+        return;
+
+    MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
+    state->profiling = enabled;
+}
+
+void motion_detector_get_stage_times(void* detector, MotionStageTimes* times)
+{
+    if(!times)
+        return;
+    memset(times, 0, sizeof(*times));
+    if(!detector)
+        return;
+
+    MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
+    *times = state->times;
+}
+
+void motion_detector_reset_stage_times(void* detector)
+{
+    if(!detector)
+        return;
+
+    MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
+    memset(&state->times, 0, sizeof(state->times));
+}
+
 void motion_detector_destroy(void* detector)
 {
     if (detector)
     {
         MotionDetectorState* state = static_cast<MotionDetectorState*>(detector);
+        delete state->pool;
         delete state;
     }
 }
\ No newline at end of file
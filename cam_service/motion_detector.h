@@ -9,16 +9,80 @@ extern "C"
 {
     #endif
 
+    // Tryb porównania w motion_detector_push_frame
+    typedef enum {
+        MOTION_MODE_FRAME_DIFF = 0,   // różnica z poprzednią podaną klatką
+        MOTION_MODE_BACKGROUND = 1    // różnica ze średnią kroczącą (modelem tła)
+    } MotionMode;
+
+    #define MOTION_MAX_THREADS 8
+
+    // Rodzaj rozmycia przed porównaniem
+    typedef enum {
+        MOTION_BLUR_GAUSSIAN = 0,     // Gauss rozdzielny (jak GaussianBlur z OpenCV), kernel gaussBlur
+        MOTION_BLUR_BOX = 1           // 3x box (sumy biegnące) o tej samej sigmie - koszt niezależny od kernela
+    } MotionBlur;
+
+    // Format klatek podawanych do detektora
+    typedef enum {
+        MOTION_INPUT_YUYV = 0,        // surowe YUYV width x height
+        MOTION_INPUT_MJPEG = 1        // klatki JPEG; dekodowana tylko luminancja w skali
+                                      // 1/analysisScale (skalowanie DCT, bez pełnego dekodowania)
+    } MotionInput;
+
     // Parametry detekcji ruchu
     typedef struct {
         int motionThreshold;  // próg różnicy (0-255), domyślnie 20
-        int minArea;          // minimalna powierzchnia konturu, domyślnie 200
+        int minArea;          // minimalna powierzchnia plamy ruchu w pikselach, domyślnie 200
         int gaussBlur;        // rozmiar kernela Gaussa (nieparzysta), domyślnie 21
+        int analysisScale;    // pomniejszenie analizy: 1, 2 lub 4 (0 = 1), dla MJPEG także 8;
+                              // minArea i gaussBlur są podawane dla pełnej rozdzielczości
+                              // i przeliczane automatycznie
+        MotionMode mode;      // tryb porównania, domyślnie MOTION_MODE_FRAME_DIFF
+        int backgroundShift;  // waga aktualizacji tła 1/2^n (0 = 4, czyli 1/16)
+        MotionBlur blur;      // rodzaj rozmycia, domyślnie MOTION_BLUR_GAUSSIAN
+        int threads;          // liczba pasów/wątków analizy (0 = 1, max MOTION_MAX_THREADS)
+        MotionInput input;    // format klatek, domyślnie MOTION_INPUT_YUYV
     } MotionParams;
 
+    #define MOTION_MAX_BOXES 8
+    #define MOTION_TILES_X 16
+    #define MOTION_TILES_Y 12
+
+    // Ramka plamy ruchu we współrzędnych pełnej rozdzielczości
+    typedef struct {
+        int x;
+        int y;
+        int width;
+        int height;
+        int area;             // powierzchnia plamy w pikselach
+    } MotionBox;
+
+    // Pełny wynik detekcji
+    typedef struct {
+        bool motion;          // to samo co wynik motion_detector_detect
+        int changedArea;      // liczba zmienionych pikseli (po pogrubieniu)
+        float score;          // udział zmienionych pikseli w klatce (0.0 - 1.0)
+        int boxCount;
+        MotionBox boxes[MOTION_MAX_BOXES];      // największe plamy > minArea, malejąco
+        unsigned short tiles[MOTION_TILES_Y];   // bit x w wierszu y = zmiana w kafelku (x, y)
+    } MotionResult;
+
+    // Sumaryczne czasy etapów detekcji [ms] (przy włączonym profilowaniu)
+    typedef struct {
+        unsigned long calls;  // wywołania detect/push_frame
+        double lumaMs;        // wyciągnięcie luminancji
+        double blurMs;        // rozmycie
+        double diffMs;        // różnica klatek / od modelu tła
+        double thresholdMs;   // progowanie
+        double dilateMs;      // pogrubienie + zliczenie zmienionych pikseli
+        double blobsMs;       // szukanie plam (dawniej kontury)
+    } MotionStageTimes;
+
     /**
      * Inicjalizacja detektora ruchu
      * Zwraca: wskaźnik do wewnętrznego stanu (nieprzezroczysty)
+     *         lub NULL przy nieprawidłowych parametrach
      */
     void* motion_detector_init(int width, int height, MotionParams params);
 
@@ -37,6 +101,61 @@ extern "C"
                                 const unsigned char* currentBuffer, size_t currentSize,
                                 const unsigned char* prevBuffer, size_t prevSize);
 
+    /**
+     * Jak motion_detector_detect, ale wypełnia result (może być NULL).
+     * Przy wyniku analizowany jest cały obraz - bez wczesnego wyjścia.
+     */
+    bool motion_detector_detect_ex(void* detector,
+                                   const unsigned char* currentBuffer, size_t currentSize,
+                                   const unsigned char* prevBuffer, size_t prevSize,
+                                   MotionResult* result);
+
+    /**
+     * Strumieniowa detekcja ruchu - podajemy tylko nową klatkę YUYV
+     * (lub JPEG przy MOTION_INPUT_MJPEG - wtedy frameSize to rozmiar danych JPEG).
+     * Detektor trzyma u siebie przetworzoną (szarą i rozmytą) poprzednią klatkę,
+     * więc każda klatka jest konwertowana i rozmywana tylko raz.
+     *
+     * @param detector - wskaźnik zwrócony przez motion_detector_init
+     * @param frameBuffer - bufor z aktualną klatką YUYV
+     * @param frameSize - rozmiar bufora frameBuffer
+     *
+     * W trybie MOTION_MODE_BACKGROUND klatka jest porównywana z modelem tła,
+     * który jest potem aktualizowany tą klatką.
+     *
+     * @return true jeśli wykryto ruch względem poprzednio podanej klatki (lub tła),
+     *         false w przeciwnym razie (także dla pierwszej klatki po init/reset)
+     */
+    bool motion_detector_push_frame(void* detector, const unsigned char* frameBuffer, size_t frameSize);
+
+    /**
+     * Jak motion_detector_push_frame, ale wypełnia result (może być NULL)
+     */
+    bool motion_detector_push_frame_ex(void* detector, const unsigned char* frameBuffer, size_t frameSize,
+                                       MotionResult* result);
+
+    /**
+     * Zapomnienie poprzedniej klatki (np. po restarcie strumienia)
+     */
+    void motion_detector_reset(void* detector);
+
+    /**
+     * Hook testowy: liczba (re)alokacji buforów roboczych detektora od init.
+     * Wszystkie bufory są alokowane w motion_detector_init, więc w stanie
+     * ustalonym wartość powinna pozostać 0. Dla wejścia YUYV push_frame nie
+     * alokuje w ogóle (także wewnątrz OpenCV); dekoder MJPEG alokuje przy
+     * każdej klatce.
+     */
+    size_t motion_detector_alloc_count(void* detector);
+
+    /**
+     * Profilowanie etapów (domyślnie wyłączone). Przy włączonym progowanie
+     * jest liczone jako osobny etap, więc wyniki są minimalnie wolniejsze.
+     */
+    void motion_detector_set_profiling(void* detector, bool enabled);
+    void motion_detector_get_stage_times(void* detector, MotionStageTimes* times);
+    void motion_detector_reset_stage_times(void* detector);
+
     /**
      * Zwolnienie zasobów detektora
      */
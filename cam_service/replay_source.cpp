@@ -0,0 +1,264 @@
+#include "replay_source.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct ReplayMapping {
+    void* addr;
+    size_t length;
+};
+
+struct ReplaySource {
+    ReplaySourceParams params;
+    size_t frameSize;
+    std::vector<ReplayMapping> mappings;
+    std::vector<const unsigned char*> frames;   // wskaźniki do mappings, kolejność odtwarzania
+
+    CaptureFrameFn onFrame;
+    void* user;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable stopCv;
+    bool stopping;                              // mutex
+    std::atomic<bool> finished;
+
+    // wątek odtwarzania, czytane z innych wątków
+    std::atomic<unsigned long> framesSent;
+    std::atomic<unsigned long> late;
+    std::atomic<long long> lastFrameUs;         // od startedAt
+    Clock::time_point startedAt;
+};
+
+static bool endsWith(const std::string& text, const char* suffix)
+{
+    size_t n = strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+// plik do pamięci i jego klatki na koniec listy
+static bool mapFile(ReplaySource* r, const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "[REPLAY] Nie można otworzyć %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0 || (size_t)st.st_size % r->frameSize != 0)
+    {
+        fprintf(stderr, "[REPLAY] %s: rozmiar nie jest wielokrotnością klatki %zu B\n",
+                path.c_str(), r->frameSize);
+        close(fd);
+        return false;
+    }
+
+    size_t length = (size_t)st.st_size;
+    void* addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED)
+    {
+        fprintf(stderr, "[REPLAY] mmap %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    ReplayMapping mapping = {addr, length};
+    r->mappings.push_back(mapping);
+    const unsigned char* data = static_cast<const unsigned char*>(addr);
+    for(size_t offset = 0; offset < length; offset += r->frameSize)
+        r->frames.push_back(data + offset);
+    return true;
+}
+
+static bool mapPath(ReplaySource* r, const char* path)
+{
+    struct stat st;
+    if(stat(path, &st) != 0)
+    {
+        fprintf(stderr, "[REPLAY] Brak %s\n", path);
+        return false;
+    }
+    if(!S_ISDIR(st.st_mode))
+        return mapFile(r, path);
+
+    DIR* dir = opendir(path);
+    if(!dir)
+        return false;
+    std::vector<std::string> names;
+    struct dirent* entry;
+    while((entry = readdir(dir)) != NULL)
+    {
+        std::string name = entry->d_name;
+        if(endsWith(name, ".yuyv"))
+            names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    if(names.empty())
+    {
+        fprintf(stderr, "[REPLAY] Brak plików .yuyv w %s\n", path);
+        return false;
+    }
+    for(const std::string& name : names)
+    {
+        if(!mapFile(r, std::string(path) + "/" + name))
+            return false;
+    }
+    return true;
+}
+
+static void replayLoop(ReplaySource* r)
+{
+    const ReplaySourceParams& p = r->params;
+    Clock::duration interval = Clock::duration::zero();
+    if(p.fps > 0)
+        interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / p.fps));
+    std::mt19937 rng(p.seed);
+    std::uniform_int_distribution<int> jitterUs(p.fps > 0 ? -p.jitterMs * 1000 : 0, p.jitterMs * 1000);
+
+    // termin klatki = base + jitter; base rośnie o równy interwał, więc jitter
+    // nie przesuwa kolejnych klatek i średnie tempo zostaje dokładnie fps
+    Clock::time_point base = r->startedAt;
+    for(int loop = 0; p.loops == 0 || loop < p.loops; loop++)
+    {
+        for(const unsigned char* frame : r->frames)
+        {
+            if(p.fps <= 0)
+                base = Clock::now();
+            Clock::time_point due = base;
+            if(p.jitterMs > 0)
+                due += std::chrono::microseconds(jitterUs(rng));
+
+            {
+                std::unique_lock<std::mutex> lock(r->mutex);
+                if(r->stopCv.wait_until(lock, due, [r] { return r->stopping; }))
+                    return;
+            }
+
+            // odbiorca nie nadąża - bez nadrabiania serią klatek, tempo od teraz
+            Clock::time_point now = Clock::now();
+            if(p.fps > 0 && now - due > interval)
+            {
+                r->late.fetch_add(1, std::memory_order_relaxed);
+                base = now;
+            }
+
+            r->onFrame(frame, r->frameSize, r->user);
+            r->framesSent.fetch_add(1, std::memory_order_relaxed);
+            long long us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - r->startedAt).count();
+            r->lastFrameUs.store(us, std::memory_order_relaxed);
+            base += interval;
+        }
+    }
+    r->finished.store(true, std::memory_order_release);
+}
+
+static bool replayStart(void* impl, CaptureFrameFn onFrame, void* user)
+{
+    ReplaySource* r = static_cast<ReplaySource*>(impl);
+    r->onFrame = onFrame;
+    r->user = user;
+    r->startedAt = Clock::now();
+    try
+    {
+        r->worker = std::thread(replayLoop, r);
+    }
+    catch(...)
+    {
+        return false;
+    }
+    return true;
+}
+
+static void replayStop(void* impl)
+{
+    ReplaySource* r = static_cast<ReplaySource*>(impl);
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        r->stopping = true;
+    }
+    r->stopCv.notify_all();
+    if(r->worker.joinable())
+        r->worker.join();
+}
+
+static bool replayFinished(void* impl)
+{
+    return static_cast<ReplaySource*>(impl)->finished.load(std::memory_order_acquire);
+}
+
+static void replayGetStats(void* impl, CaptureStats* stats)
+{
+    ReplaySource* r = static_cast<ReplaySource*>(impl);
+    stats->frames = r->framesSent.load(std::memory_order_relaxed);
+    stats->late = r->late.load(std::memory_order_relaxed);
+    stats->elapsedMs = r->lastFrameUs.load(std::memory_order_relaxed) / 1000.0;
+}
+
+static void replayDestroy(void* impl)
+{
+    ReplaySource* r = static_cast<ReplaySource*>(impl);
+    replayStop(r);
+    for(const ReplayMapping& mapping : r->mappings)
+        munmap(mapping.addr, mapping.length);
+    delete r;
+}
+
+static const CaptureSourceOps replayOps = {
+    "replay", replayStart, replayStop, replayFinished, replayGetStats, replayDestroy
+};
+
+CaptureSource* replay_source_open(ReplaySourceParams params)
+{
+    if(!params.path || params.width <= 0 || params.height <= 0 || params.width % 2 != 0)
+        return NULL;
+    if(params.fps < 0 || params.jitterMs < 0 || params.loops < 0)
+        return NULL;
+
+    ReplaySource* r = new (std::nothrow) ReplaySource();
+    if(!r)
+        return NULL;
+
+    r->params = params;
+    r->params.path = NULL;      // ścieżka potrzebna tylko przy otwarciu
+    r->frameSize = (size_t)params.width * params.height * 2;
+    r->onFrame = NULL;
+    r->user = NULL;
+    r->stopping = false;
+    r->finished = false;
+    r->framesSent = 0;
+    r->late = 0;
+    r->lastFrameUs = 0;
+
+    if(!mapPath(r, params.path))
+    {
+        replayDestroy(r);
+        return NULL;
+    }
+
+    CaptureInfo info;
+    info.format = CAPTURE_FORMAT_YUYV;
+    info.width = params.width;
+    info.height = params.height;
+    info.maxFrameSize = r->frameSize;
+    return capture_source_create(&replayOps, r, info);
+}
@@ -0,0 +1,43 @@
+#ifndef REPLAY_SOURCE_H
+#define REPLAY_SOURCE_H
+
+#include "capture_source.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Odtwarzanie surowych klatek YUYV zamiast kamery - testy i pomiary
+     * przepustowości usługi bez sprzętu. Źródłem jest plik .yuyv z jedną lub
+     * wieloma klatkami jedna za drugą albo katalog, którego pliki *.yuyv są
+     * odtwarzane w kolejności nazw.
+     *
+     * Pliki są mapowane do pamięci przy otwarciu - odczyt z dysku nie zaburza
+     * tempa. Klatki wydaje własny wątek: w tempie fps (z opcjonalnym losowym
+     * przesunięciem każdej klatki o +-jitterMs, bez dryfu średniego tempa)
+     * albo przy fps == 0 tak szybko, jak odbiorca je przyjmuje.
+     */
+
+    typedef struct {
+        const char* path;       // plik .yuyv albo katalog z plikami .yuyv
+        int width;
+        int height;
+        double fps;             // 0 = bez ograniczenia
+        int jitterMs;           // przesunięcie pojedynczej klatki (fps == 0: tylko opóźnienie 0..jitterMs)
+        int loops;              // przebiegi przez wszystkie klatki, 0 = bez końca
+        unsigned int seed;      // ziarno jittera - powtarzalne przebiegi
+    } ReplaySourceParams;
+
+    /**
+     * Zwraca: źródło (CAPTURE_FORMAT_YUYV) lub NULL - brak plików, rozmiar
+     * pliku niebędący wielokrotnością klatki, złe parametry
+     */
+    CaptureSource* replay_source_open(ReplaySourceParams params);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // REPLAY_SOURCE_H
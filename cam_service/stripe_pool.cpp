@@ -0,0 +1,89 @@
+#include "stripe_pool.h"
+
+// granice pasa - te same dla każdego wywołania o tej samej liczbie wierszy
+static inline void stripeBounds(int stripe, int stripes, int rows, int* begin, int* end)
+{
+    *begin = rows * stripe / stripes;
+    *end = rows * (stripe + 1) / stripes;
+}
+
+StripePool::StripePool(int stripes)
+    : stripeCount(stripes < 1 ? 1 : stripes),
+      jobFn(nullptr),
+      jobCtx(nullptr),
+      jobRows(0),
+      generation(0),
+      pending(0),
+      stopping(false)
+{
+    for(int i = 1; i < stripeCount; i++)
+    {
+        workers.emplace_back(&StripePool::workerLoop, this, i);
+    }
+}
+
+StripePool::~StripePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCv.notify_all();
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void StripePool::run(StripeFn fn, void* ctx, int rows)
+{
+    if(stripeCount == 1)
+    {
+        fn(ctx, 0, 0, rows);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobFn = fn;
+        jobCtx = ctx;
+        jobRows = rows;
+        pending = stripeCount - 1;
+        generation++;
+    }
+    startCv.notify_all();
+
+    int begin, end;
+    stripeBounds(0, stripeCount, rows, &begin, &end);
+    fn(ctx, 0, begin, end);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this] { return pending == 0; });
+}
+
+void StripePool::workerLoop(int stripe)
+{
+    unsigned long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;)
+    {
+        startCv.wait(lock, [&] { return stopping || generation != seen; });
+        if(stopping)
+            return;
+
+        seen = generation;
+        StripeFn fn = jobFn;
+        void* ctx = jobCtx;
+        int begin, end;
+        stripeBounds(stripe, stripeCount, jobRows, &begin, &end);
+
+        lock.unlock();
+        fn(ctx, stripe, begin, end);
+        lock.lock();
+
+        if(--pending == 0)
+        {
+            doneCv.notify_one();
+        }
+    }
+}
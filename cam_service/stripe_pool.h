@@ -0,0 +1,46 @@
+#ifndef STRIPE_POOL_H
+#define STRIPE_POOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Stała pula wątków dzieląca obraz na poziome pasy.
+// Wątek wywołujący liczy pas 0, pozostałe pasy liczą wątki puli.
+// run() nie alokuje pamięci i wraca dopiero po przetworzeniu wszystkich pasów.
+class StripePool
+{
+public:
+    // fn(ctx, indeks pasa, pierwszy wiersz, wiersz za ostatnim)
+    typedef void (*StripeFn)(void* ctx, int stripe, int rowBegin, int rowEnd);
+
+    explicit StripePool(int stripes);
+    ~StripePool();
+
+    int stripes() const { return stripeCount; }
+
+    void run(StripeFn fn, void* ctx, int rows);
+
+private:
+    StripePool(const StripePool&) = delete;
+    StripePool& operator=(const StripePool&) = delete;
+
+    void workerLoop(int stripe);
+
+    int stripeCount;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+
+    // bieżące zadanie - chronione przez mutex
+    StripeFn jobFn;
+    void* jobCtx;
+    int jobRows;
+    unsigned long generation;
+    int pending;
+    bool stopping;
+};
+
+#endif // STRIPE_POOL_H
@@ -0,0 +1,280 @@
+#include "tile_delta.h"
+#include <opencv2/opencv.hpp>
+#include <new>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+using namespace cv;
+
+struct TileDeltaState {
+    int width;
+    int height;
+    int tileSize;
+    int tilesX;
+    int tilesY;
+    size_t tileBytes;               // tileSize * tileSize * 2
+    double tileThreshold;           // threshold * tileBytes - próg SAD kafelka
+    int keyframeInterval;
+    int sinceKeyframe;              // pakiety od ostatniej klatki kluczowej
+    bool forceKeyframe;
+    uint32_t sequence;
+    Mat reference;                  // obraz po stronie odbiorcy: height x width*2, CV_8UC1
+    std::vector<uint16_t> changed;  // indeksy kafelków bieżącego pakietu
+    TileDeltaStats stats;
+};
+
+// ============ FORMAT ============
+
+static inline void put16(unsigned char* p, unsigned v)
+{
+    p[0] = (unsigned char)(v & 0xFF);
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void put32(unsigned char* p, uint32_t v)
+{
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static inline unsigned get16(const unsigned char* p)
+{
+    return p[0] | ((unsigned)p[1] << 8);
+}
+
+static void writeHeader(unsigned char* out, const TileDeltaState* state, bool keyframe, unsigned tiles)
+{
+    out[0] = 'T';
+    out[1] = 'D';
+    out[2] = TILE_DELTA_VERSION;
+    out[3] = keyframe ? TILE_DELTA_KEYFRAME : 0;
+    put16(out + 4, state->width);
+    put16(out + 6, state->height);
+    put16(out + 8, state->tileSize);
+    put16(out + 10, tiles);
+    put32(out + 12, state->sequence);
+}
+
+static inline size_t frameBytes(int width, int height)
+{
+    return (size_t)width * height * 2;
+}
+
+// kafelek `index` jako ROI obrazu YUYV traktowanego jako height x width*2 bajtów
+static inline Rect tileRect(int index, int tilesX, int tileSize)
+{
+    return Rect((index % tilesX) * tileSize * 2, (index / tilesX) * tileSize, tileSize * 2, tileSize);
+}
+
+// ============ KODER ============
+
+void* tile_delta_init(int width, int height, int tileSize, int threshold, int keyframeInterval)
+{
+    if(width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF)
+        return NULL;
+    // kafelek obejmuje całe pary pikseli YUYV i dzieli obraz bez reszty
+    if(tileSize < 2 || tileSize % 2 || width % tileSize || height % tileSize)
+        return NULL;
+    if(threshold < 0 || keyframeInterval < 1)
+        return NULL;
+    if((width / tileSize) * (height / tileSize) > 0xFFFF)
+        return NULL;
+
+    TileDeltaState* state = new (std::nothrow) TileDeltaState();
+    if(!state)
+        return NULL;
+
+    state->width = width;
+    state->height = height;
+    state->tileSize = tileSize;
+    state->tilesX = width / tileSize;
+    state->tilesY = height / tileSize;
+    state->tileBytes = (size_t)tileSize * tileSize * 2;
+    state->tileThreshold = (double)threshold * state->tileBytes;
+    state->keyframeInterval = keyframeInterval;
+    state->sinceKeyframe = 0;
+    state->forceKeyframe = true;
+    state->sequence = 0;
+    state->reference.create(height, width * 2, CV_8UC1);
+    state->changed.reserve((size_t)state->tilesX * state->tilesY);
+    memset(&state->stats, 0, sizeof(state->stats));
+
+    return state;
+}
+
+size_t tile_delta_max_packet_size(int width, int height)
+{
+    if(width <= 0 || height <= 0)
+        return 0;
+    return TILE_DELTA_HEADER_SIZE + frameBytes(width, height);
+}
+
+size_t tile_delta_encode(void* encoder, const unsigned char* yuyv, size_t yuyvSize,
+                         unsigned char* out, size_t outCapacity)
+{
+    if(!encoder || !yuyv || !out)
+        return 0;
+
+    TileDeltaState* state = static_cast<TileDeltaState*>(encoder);
+    const size_t fullSize = frameBytes(state->width, state->height);
+    if(yuyvSize != fullSize)
+    {
+        state->stats.failed++;
+        return 0;
+    }
+
+    Mat current(state->height, state->width * 2, CV_8UC1, (void*)yuyv);
+    const int tiles = state->tilesX * state->tilesY;
+
+    bool keyframe = state->forceKeyframe || state->sinceKeyframe >= state->keyframeInterval;
+    state->changed.clear();
+    if(!keyframe)
+    {
+        // SAD kafelka względem obrazu odbiorcy (YUYV - luminancja i chrominancja razem)
+        for(int i = 0; i < tiles; i++)
+        {
+            Rect r = tileRect(i, state->tilesX, state->tileSize);
+            if(norm(current(r), state->reference(r), NORM_L1) > state->tileThreshold)
+                state->changed.push_back((uint16_t)i);
+        }
+        // prawie wszystko się zmieniło - pełna klatka jest mniejsza
+        if(state->changed.size() * (2 + state->tileBytes) >= fullSize)
+            keyframe = true;
+    }
+
+    size_t packetSize = TILE_DELTA_HEADER_SIZE +
+        (keyframe ? fullSize : state->changed.size() * (2 + state->tileBytes));
+    if(packetSize > outCapacity)
+    {
+        state->stats.failed++;
+        return 0;
+    }
+
+    unsigned char* p = out + TILE_DELTA_HEADER_SIZE;
+    if(keyframe)
+    {
+        writeHeader(out, state, true, tiles);
+        memcpy(p, yuyv, fullSize);
+        current.copyTo(state->reference);
+        state->forceKeyframe = false;
+        state->sinceKeyframe = 0;
+        state->stats.keyframes++;
+    }
+    else
+    {
+        writeHeader(out, state, false, (unsigned)state->changed.size());
+        const size_t rowBytes = (size_t)state->tileSize * 2;
+        for(uint16_t index : state->changed)
+        {
+            put16(p, index);
+            p += 2;
+            Rect r = tileRect(index, state->tilesX, state->tileSize);
+            for(int y = 0; y < r.height; y++)
+            {
+                memcpy(p, current.ptr(r.y + y) + r.x, rowBytes);
+                p += rowBytes;
+            }
+            current(r).copyTo(state->reference(r));
+        }
+        state->stats.tilesSent += state->changed.size();
+        state->stats.tilesTotal += tiles;
+    }
+
+    state->sinceKeyframe++;
+    state->sequence++;
+    state->stats.frames++;
+    state->stats.lastBytes = packetSize;
+    state->stats.totalBytes += packetSize;
+
+    return packetSize;
+}
+
+void tile_delta_force_keyframe(void* encoder)
+{
+    if(!encoder)
+        return;
+    static_cast<TileDeltaState*>(encoder)->forceKeyframe = true;
+}
+
+void tile_delta_get_stats(void* encoder, TileDeltaStats* stats)
+{
+    if(!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if(!encoder)
+        return;
+
+    TileDeltaState* state = static_cast<TileDeltaState*>(encoder);
+    *stats = state->stats;
+}
+
+void tile_delta_destroy(void* encoder)
+{
+    delete static_cast<TileDeltaState*>(encoder);
+}
+
+// ============ DEKODER REFERENCYJNY ============
+
+bool tile_delta_is_keyframe(const unsigned char* packet, size_t packetSize)
+{
+    if(!packet || packetSize < TILE_DELTA_HEADER_SIZE)
+        return false;
+    if(packet[0] != 'T' || packet[1] != 'D' || packet[2] != TILE_DELTA_VERSION)
+        return false;
+    if(!(packet[3] & TILE_DELTA_KEYFRAME))
+        return false;
+    return packetSize == TILE_DELTA_HEADER_SIZE + frameBytes(get16(packet + 4), get16(packet + 6));
+}
+
+bool tile_delta_decode(const unsigned char* packet, size_t packetSize,
+                       unsigned char* frame, int width, int height)
+{
+    if(!packet || !frame || packetSize < TILE_DELTA_HEADER_SIZE)
+        return false;
+    if(packet[0] != 'T' || packet[1] != 'D' || packet[2] != TILE_DELTA_VERSION)
+        return false;
+    if((int)get16(packet + 4) != width || (int)get16(packet + 6) != height)
+        return false;
+
+    const size_t fullSize = frameBytes(width, height);
+    const unsigned char* p = packet + TILE_DELTA_HEADER_SIZE;
+    if(packet[3] & TILE_DELTA_KEYFRAME)
+    {
+        if(packetSize != TILE_DELTA_HEADER_SIZE + fullSize)
+            return false;
+        memcpy(frame, p, fullSize);
+        return true;
+    }
+
+    const int tileSize = get16(packet + 8);
+    if(tileSize < 2 || tileSize % 2 || width % tileSize || height % tileSize)
+        return false;
+    const int tilesX = width / tileSize;
+    const int tiles = tilesX * (height / tileSize);
+    const size_t count = get16(packet + 10);
+    const size_t rowBytes = (size_t)tileSize * 2;
+    const size_t tileBytes = rowBytes * tileSize;
+    if(packetSize != TILE_DELTA_HEADER_SIZE + count * (2 + tileBytes))
+        return false;
+
+    // najpierw walidacja indeksów - uszkodzony pakiet nie zmienia obrazu
+    for(size_t i = 0; i < count; i++)
+    {
+        if((int)get16(p + i * (2 + tileBytes)) >= tiles)
+            return false;
+    }
+
+    const size_t stride = (size_t)width * 2;
+    for(size_t i = 0; i < count; i++)
+    {
+        Rect r = tileRect(get16(p), tilesX, tileSize);
+        p += 2;
+        for(int y = 0; y < tileSize; y++)
+        {
+            memcpy(frame + (size_t)(r.y + y) * stride + r.x, p, rowBytes);
+            p += rowBytes;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef TILE_DELTA_H
+#define TILE_DELTA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Stream różnicowy YUYV: co keyframeInterval klatek pełna klatka kluczowa,
+     * pomiędzy nimi tylko kafelki tileSize x tileSize, które zmieniły się
+     * względem obrazu po stronie odbiorcy o więcej niż threshold.
+     *
+     * Pakiet (liczby little-endian):
+     *   nagłówek TILE_DELTA_HEADER_SIZE bajtów:
+     *     [0..1] 'T' 'D', [2] wersja, [3] flagi (TILE_DELTA_KEYFRAME),
+     *     [4..5] szerokość, [6..7] wysokość, [8..9] rozmiar kafelka,
+     *     [10..11] liczba kafelków w pakiecie, [12..15] numer pakietu
+     *   klatka kluczowa: cała klatka YUYV (width * height * 2 bajtów)
+     *   różnicowa: dla każdego kafelka indeks (u16, wierszami) + wiersze
+     *              kafelka w YUYV (tileSize * tileSize * 2 bajtów)
+     */
+
+    #define TILE_DELTA_HEADER_SIZE 16
+    #define TILE_DELTA_VERSION 1
+    #define TILE_DELTA_KEYFRAME 0x01
+
+    // Statystyki kodowania od init
+    typedef struct {
+        unsigned long frames;       // zakodowane pakiety
+        unsigned long keyframes;    // w tym klatki kluczowe
+        unsigned long failed;       // zły rozmiar wejścia / za mały bufor
+        unsigned long tilesSent;    // kafelki w pakietach różnicowych
+        unsigned long tilesTotal;   // kafelki sprawdzone w pakietach różnicowych
+        size_t lastBytes;           // rozmiar ostatniego pakietu
+        size_t totalBytes;
+    } TileDeltaStats;
+
+    /**
+     * @param tileSize - bok kafelka (parzysty, dzieli szerokość i wysokość)
+     * @param threshold - średnia różnica bezwzględna na bajt kafelka, powyżej
+     *                    której kafelek jest wysyłany (0 = każda zmiana)
+     * @param keyframeInterval - co ile pakietów klatka kluczowa (>= 1)
+     * Zwraca: wskaźnik do kodera (nieprzezroczysty) lub NULL przy złych parametrach
+     */
+    void* tile_delta_init(int width, int height, int tileSize, int threshold, int keyframeInterval);
+
+    /**
+     * Największy możliwy pakiet (klatka kluczowa) dla danej rozdzielczości
+     */
+    size_t tile_delta_max_packet_size(int width, int height);
+
+    /**
+     * Kodowanie klatki YUYV (width * height * 2 bajtów) do out.
+     * Gdy pakiet różnicowy nie byłby mniejszy od pełnej klatki, wysyłana jest
+     * klatka kluczowa.
+     * @return rozmiar pakietu lub 0 gdy zły rozmiar wejścia / za mały outCapacity
+     */
+    size_t tile_delta_encode(void* encoder, const unsigned char* yuyv, size_t yuyvSize,
+                             unsigned char* out, size_t outCapacity);
+
+    /**
+     * Następny pakiet będzie klatką kluczową (np. nowy odbiorca)
+     */
+    void tile_delta_force_keyframe(void* encoder);
+
+    void tile_delta_get_stats(void* encoder, TileDeltaStats* stats);
+
+    void tile_delta_destroy(void* encoder);
+
+    /**
+     * Czy pakiet jest poprawną klatką kluczową (odbiorca może od niego zacząć)
+     */
+    bool tile_delta_is_keyframe(const unsigned char* packet, size_t packetSize);
+
+    /**
+     * Dekoder referencyjny: nałożenie pakietu na frame (width * height * 2 bajtów,
+     * stan odbiorcy). Pakiet różnicowy wymaga frame po poprzednich pakietach.
+     * @return false przy uszkodzonym pakiecie lub innej rozdzielczości (frame bez zmian)
+     */
+    bool tile_delta_decode(const unsigned char* packet, size_t packetSize,
+                           unsigned char* frame, int width, int height);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // TILE_DELTA_H
@@ -0,0 +1,133 @@
+#include "uvc_source.h"
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+struct UvcSource {
+    uvc_device_t* device;
+    uvc_device_handle_t* handle;
+    uvc_stream_ctrl_t streamCtrl;
+    enum uvc_frame_format frameFormat;
+    CaptureFrameFn onFrame;
+    void* user;
+
+    // wątek libuvc
+    std::atomic<unsigned long> frames;
+    std::atomic<unsigned long> rejected;
+    Clock::time_point startedAt;
+    std::atomic<long long> lastFrameUs;     // od startedAt
+};
+
+static void uvcCallback(uvc_frame_t* frame, void* ptr)
+{
+    UvcSource* s = static_cast<UvcSource*>(ptr);
+    if(!frame || frame->frame_format != s->frameFormat)
+    {
+        s->rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    s->onFrame((const unsigned char*)frame->data, frame->data_bytes, s->user);
+    s->frames.fetch_add(1, std::memory_order_relaxed);
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s->startedAt).count();
+    s->lastFrameUs.store(us, std::memory_order_relaxed);
+}
+
+static bool uvcStart(void* impl, CaptureFrameFn onFrame, void* user)
+{
+    UvcSource* s = static_cast<UvcSource*>(impl);
+    s->onFrame = onFrame;
+    s->user = user;
+    s->startedAt = Clock::now();
+
+    usleep(100000); // 100ms delay
+    uvc_error_t res = uvc_start_streaming(s->handle, &s->streamCtrl, uvcCallback, s, 0);
+    if(res < 0)
+    {
+        uvc_perror(res, "[CAM] Błąd uruchomienia streamu");
+        return false;
+    }
+    return true;
+}
+
+static void uvcStop(void* impl)
+{
+    uvc_stop_streaming(static_cast<UvcSource*>(impl)->handle);
+}
+
+static void uvcGetStats(void* impl, CaptureStats* stats)
+{
+    UvcSource* s = static_cast<UvcSource*>(impl);
+    stats->frames = s->frames.load(std::memory_order_relaxed);
+    stats->rejected = s->rejected.load(std::memory_order_relaxed);
+    stats->elapsedMs = s->lastFrameUs.load(std::memory_order_relaxed) / 1000.0;
+}
+
+static void uvcDestroy(void* impl)
+{
+    UvcSource* s = static_cast<UvcSource*>(impl);
+    if(s->handle)
+        uvc_close(s->handle);
+    uvc_unref_device(s->device);
+    delete s;
+}
+
+static const CaptureSourceOps uvcOps = {
+    "uvc", uvcStart, uvcStop, NULL, uvcGetStats, uvcDestroy
+};
+
+CaptureSource* uvc_source_open(uvc_device_t* device, CaptureFormat format,
+                               int width, int height, int fps)
+{
+    if(!device)
+        return NULL;
+
+    UvcSource* s = new (std::nothrow) UvcSource();
+    if(!s)
+    {
+        uvc_unref_device(device);
+        return NULL;
+    }
+    s->device = device;
+    s->handle = NULL;
+    s->frameFormat = format == CAPTURE_FORMAT_MJPEG ? UVC_FRAME_FORMAT_MJPEG : UVC_FRAME_FORMAT_YUYV;
+    s->onFrame = NULL;
+    s->user = NULL;
+    s->frames = 0;
+    s->rejected = 0;
+    s->lastFrameUs = 0;
+
+    uvc_error_t res = uvc_open(device, &s->handle);
+    if(res < 0)
+    {
+        uvc_perror(res, "uvc_open");
+        s->handle = NULL;
+        uvcDestroy(s);
+        return NULL;
+    }
+
+    usleep(300000); // 300ms delay
+
+    res = uvc_get_stream_ctrl_format_size(s->handle, &s->streamCtrl, s->frameFormat, width, height, fps);
+    if(res < 0)
+    {
+        uvc_perror(res, "get_stream_ctrl");
+        uvcDestroy(s);
+        return NULL;
+    }
+
+    // rozmiar MJPEG podaje kamera dopiero po negocjacji
+    CaptureInfo info;
+    info.format = format;
+    info.width = width;
+    info.height = height;
+    info.maxFrameSize = (size_t)width * height * 2;
+    if(format == CAPTURE_FORMAT_MJPEG && s->streamCtrl.dwMaxVideoFrameSize > 0)
+        info.maxFrameSize = s->streamCtrl.dwMaxVideoFrameSize;
+
+    return capture_source_create(&uvcOps, s, info);
+}
@@ -0,0 +1,27 @@
+#ifndef UVC_SOURCE_H
+#define UVC_SOURCE_H
+
+#include <libuvc/libuvc.h>
+#include "capture_source.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    /**
+     * Kamera UVC jako źródło klatek: otwarcie urządzenia i negocjacja
+     * strumienia (format, rozmiar, fps). Klatki w innym formacie niż
+     * wynegocjowany są odrzucane (CaptureStats.rejected).
+     *
+     * Przejmuje referencję device (zwalnia ją także przy błędzie).
+     * Zwraca: źródło lub NULL
+     */
+    CaptureSource* uvc_source_open(uvc_device_t* device, CaptureFormat format,
+                                   int width, int height, int fps);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // UVC_SOURCE_H
@@ -0,0 +1,374 @@
+#include "yuyv_luma.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define YUYV_LUMA_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define YUYV_LUMA_ARM_NEON 1
+#define NEON_TARGET
+#include <arm_neon.h>
+#elif defined(__arm__) && (defined(__ARM_NEON) || (defined(__ARM_FP) && __GNUC__ >= 8))
+// armhf domyślnie kompiluje bez NEON, a ARMv6 (Pi 1, Zero) go nie ma -
+// fpu=neon dostają tylko kernele NEON, obecność NEON sprawdza isaSupported
+#define YUYV_LUMA_ARM_NEON 1
+#define YUYV_LUMA_NEON_HWCAP 1
+#define NEON_TARGET __attribute__((target("fpu=neon")))
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+typedef unsigned char uchar;
+
+// ============ WARIANT SKALARNY ============
+
+// reszta wiersza wyjścia od kolumny x (ogon po pętli wektorowej)
+template<int N>
+static inline void lumaRowTail(const uchar* s, size_t srcStride, uchar* d, int x, int outW)
+{
+    for(; x < outW; x++)
+    {
+        unsigned sum = 0;
+        for(int r = 0; r < N; r++)
+        {
+            const uchar* row = s + r * srcStride + x * N * 2;
+            for(int c = 0; c < N; c++)
+            {
+                sum += row[c * 2];
+            }
+        }
+        d[x] = (uchar)((sum + N * N / 2) / (N * N));
+    }
+}
+
+template<int N>
+static void lumaScalar(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const int outW = width / N;
+    const int outH = height / N;
+    for(int y = 0; y < outH; y++)
+    {
+        lumaRowTail<N>(src + (size_t)y * N * srcStride, srcStride, dst + (size_t)y * dstStride, 0, outW);
+    }
+}
+
+// ============ WARIANTY x86 ============
+
+#ifdef YUYV_LUMA_X86
+
+__attribute__((target("sse2")))
+static void lumaSse2x1(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    for(int y = 0; y < height; y++)
+    {
+        const uchar* s = src + (size_t)y * srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        for(; x + 16 <= width; x += 16)
+        {
+            __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(s + x * 2)), mask);
+            __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(s + x * 2 + 16)), mask);
+            _mm_storeu_si128((__m128i*)(d + x), _mm_packus_epi16(a, b));
+        }
+        lumaRowTail<1>(s, srcStride, d, x, width);
+    }
+}
+
+__attribute__((target("sse2")))
+static void lumaSse2x2(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi16(2);
+    const int outW = width / 2;
+    const int outH = height / 2;
+    for(int y = 0; y < outH; y++)
+    {
+        const uchar* s0 = src + (size_t)y * 2 * srcStride;
+        const uchar* s1 = s0 + srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        // 8 pikseli wyjścia = 16 próbek Y = 32 bajty z każdego wiersza
+        for(; x + 8 <= outW; x += 8)
+        {
+            const int off = x * 4;
+            __m128i va = _mm_add_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i*)(s0 + off)), mask),
+                                       _mm_and_si128(_mm_loadu_si128((const __m128i*)(s1 + off)), mask));
+            __m128i vb = _mm_add_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i*)(s0 + off + 16)), mask),
+                                       _mm_and_si128(_mm_loadu_si128((const __m128i*)(s1 + off + 16)), mask));
+            // sumy sąsiednich par w poziomie
+            __m128i p = _mm_packs_epi32(_mm_madd_epi16(va, ones), _mm_madd_epi16(vb, ones));
+            p = _mm_srli_epi16(_mm_add_epi16(p, round), 2);
+            _mm_storel_epi64((__m128i*)(d + x), _mm_packus_epi16(p, p));
+        }
+        lumaRowTail<2>(s0, srcStride, d, x, outW);
+    }
+}
+
+__attribute__((target("sse2")))
+static void lumaSse2x4(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi16(8);
+    const int outW = width / 4;
+    const int outH = height / 4;
+    for(int y = 0; y < outH; y++)
+    {
+        const uchar* s = src + (size_t)y * 4 * srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        // 8 pikseli wyjścia = 32 próbki Y = 64 bajty z każdego z 4 wierszy
+        for(; x + 8 <= outW; x += 8)
+        {
+            const int off = x * 8;
+            __m128i q[4];
+            for(int k = 0; k < 4; k++)
+            {
+                __m128i v = _mm_setzero_si128();
+                for(int r = 0; r < 4; r++)
+                {
+                    const uchar* p = s + r * srcStride + off + k * 16;
+                    v = _mm_add_epi16(v, _mm_and_si128(_mm_loadu_si128((const __m128i*)p), mask));
+                }
+                __m128i pairs = _mm_madd_epi16(v, ones);
+                // sumy bloków 4x4 lądują w lane 0 i 2
+                __m128i quads = _mm_add_epi32(pairs, _mm_srli_epi64(pairs, 32));
+                q[k] = _mm_shuffle_epi32(quads, _MM_SHUFFLE(3, 1, 2, 0));
+            }
+            __m128i lo = _mm_unpacklo_epi64(q[0], q[1]);
+            __m128i hi = _mm_unpacklo_epi64(q[2], q[3]);
+            __m128i p = _mm_packs_epi32(lo, hi);
+            p = _mm_srli_epi16(_mm_add_epi16(p, round), 4);
+            _mm_storel_epi64((__m128i*)(d + x), _mm_packus_epi16(p, p));
+        }
+        lumaRowTail<4>(s, srcStride, d, x, outW);
+    }
+}
+
+__attribute__((target("avx2")))
+static void lumaAvx2x1(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    for(int y = 0; y < height; y++)
+    {
+        const uchar* s = src + (size_t)y * srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        for(; x + 32 <= width; x += 32)
+        {
+            __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s + x * 2)), mask);
+            __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s + x * 2 + 32)), mask);
+            // packus działa w obrębie 128-bitowych połówek - przywracamy kolejność
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i*)(d + x), packed);
+        }
+        lumaRowTail<1>(s, srcStride, d, x, width);
+    }
+}
+
+__attribute__((target("avx2")))
+static void lumaAvx2x2(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i round = _mm256_set1_epi16(2);
+    const int outW = width / 2;
+    const int outH = height / 2;
+    for(int y = 0; y < outH; y++)
+    {
+        const uchar* s0 = src + (size_t)y * 2 * srcStride;
+        const uchar* s1 = s0 + srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        // 16 pikseli wyjścia = 32 próbki Y = 64 bajty z każdego wiersza
+        for(; x + 16 <= outW; x += 16)
+        {
+            const int off = x * 4;
+            __m256i va = _mm256_add_epi16(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s0 + off)), mask),
+                                          _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s1 + off)), mask));
+            __m256i vb = _mm256_add_epi16(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s0 + off + 32)), mask),
+                                          _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s1 + off + 32)), mask));
+            __m256i p = _mm256_packs_epi32(_mm256_madd_epi16(va, ones), _mm256_madd_epi16(vb, ones));
+            p = _mm256_srli_epi16(_mm256_add_epi16(p, round), 2);
+            p = _mm256_permute4x64_epi64(p, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i out = _mm_packus_epi16(_mm256_castsi256_si128(p), _mm256_extracti128_si256(p, 1));
+            _mm_storeu_si128((__m128i*)(d + x), out);
+        }
+        lumaRowTail<2>(s0, srcStride, d, x, outW);
+    }
+}
+
+#endif // YUYV_LUMA_X86
+
+// ============ WARIANTY NEON ============
+
+#ifdef YUYV_LUMA_ARM_NEON
+
+NEON_TARGET
+static void lumaNeonx1(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    for(int y = 0; y < height; y++)
+    {
+        const uchar* s = src + (size_t)y * srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        for(; x + 16 <= width; x += 16)
+        {
+            uint8x16x2_t v = vld2q_u8(s + x * 2);
+            vst1q_u8(d + x, v.val[0]);
+        }
+        lumaRowTail<1>(s, srcStride, d, x, width);
+    }
+}
+
+NEON_TARGET
+static void lumaNeonx2(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const int outW = width / 2;
+    const int outH = height / 2;
+    for(int y = 0; y < outH; y++)
+    {
+        const uchar* s0 = src + (size_t)y * 2 * srcStride;
+        const uchar* s1 = s0 + srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        for(; x + 8 <= outW; x += 8)
+        {
+            uint8x16x2_t a = vld2q_u8(s0 + x * 4);
+            uint8x16x2_t b = vld2q_u8(s1 + x * 4);
+            uint16x8_t sum = vaddq_u16(vpaddlq_u8(a.val[0]), vpaddlq_u8(b.val[0]));
+            vst1_u8(d + x, vrshrn_n_u16(sum, 2));
+        }
+        lumaRowTail<2>(s0, srcStride, d, x, outW);
+    }
+}
+
+NEON_TARGET
+static void lumaNeonx4(const uchar* src, size_t srcStride, uchar* dst, size_t dstStride, int width, int height)
+{
+    const int outW = width / 4;
+    const int outH = height / 4;
+    for(int y = 0; y < outH; y++)
+    {
+        const uchar* s = src + (size_t)y * 4 * srcStride;
+        uchar* d = dst + (size_t)y * dstStride;
+        int x = 0;
+        for(; x + 8 <= outW; x += 8)
+        {
+            uint16x8_t accA = vdupq_n_u16(0);
+            uint16x8_t accB = vdupq_n_u16(0);
+            for(int r = 0; r < 4; r++)
+            {
+                const uchar* p = s + r * srcStride + x * 8;
+                uint8x16x2_t a = vld2q_u8(p);
+                uint8x16x2_t b = vld2q_u8(p + 32);
+                accA = vaddq_u16(accA, vpaddlq_u8(a.val[0]));
+                accB = vaddq_u16(accB, vpaddlq_u8(b.val[0]));
+            }
+            uint16x4_t lo = vrshrn_n_u32(vpaddlq_u16(accA), 4);
+            uint16x4_t hi = vrshrn_n_u32(vpaddlq_u16(accB), 4);
+            vst1_u8(d + x, vmovn_u16(vcombine_u16(lo, hi)));
+        }
+        lumaRowTail<4>(s, srcStride, d, x, outW);
+    }
+}
+
+#endif // YUYV_LUMA_ARM_NEON
+
+// ============ WYBÓR WARIANTU ============
+
+static int decimationIndex(int decimation)
+{
+    switch(decimation)
+    {
+    case 1: return 0;
+    case 2: return 1;
+    case 4: return 2;
+    default: return -1;
+    }
+}
+
+static bool isaSupported(YuyvLumaIsa isa)
+{
+    switch(isa)
+    {
+    case YUYV_LUMA_SCALAR:
+        return true;
+#ifdef YUYV_LUMA_X86
+    case YUYV_LUMA_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case YUYV_LUMA_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef YUYV_LUMA_ARM_NEON
+    case YUYV_LUMA_NEON:
+#ifdef YUYV_LUMA_NEON_HWCAP
+        return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+        return true;    // AArch64 - NEON zawsze jest
+#endif
+#endif
+    default:
+        return false;
+    }
+}
+
+YuyvLumaFn yuyv_luma_get(YuyvLumaIsa isa, int decimation)
+{
+    int idx = decimationIndex(decimation);
+    if(idx < 0 || !isaSupported(isa))
+        return NULL;
+
+    // tablica [wariant][decymacja 1/2/4], NULL = brak implementacji
+    static const YuyvLumaFn table[YUYV_LUMA_ISA_COUNT][3] = {
+        { lumaScalar<1>, lumaScalar<2>, lumaScalar<4> },
+#ifdef YUYV_LUMA_X86
+        { lumaSse2x1, lumaSse2x2, lumaSse2x4 },
+        { lumaAvx2x1, lumaAvx2x2, NULL },
+#else
+        { NULL, NULL, NULL },
+        { NULL, NULL, NULL },
+#endif
+#ifdef YUYV_LUMA_ARM_NEON
+        { lumaNeonx1, lumaNeonx2, lumaNeonx4 },
+#else
+        { NULL, NULL, NULL },
+#endif
+    };
+
+    return table[isa][idx];
+}
+
+YuyvLumaFn yuyv_luma_select(int decimation, YuyvLumaIsa* isaOut)
+{
+    // od najszybszego do najwolniejszego
+    static const YuyvLumaIsa order[] = { YUYV_LUMA_AVX2, YUYV_LUMA_NEON, YUYV_LUMA_SSE2, YUYV_LUMA_SCALAR };
+
+    for(size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++)
+    {
+        YuyvLumaFn fn = yuyv_luma_get(order[i], decimation);
+        if(fn)
+        {
+            if(isaOut)
+                *isaOut = order[i];
+            return fn;
+        }
+    }
+    return NULL;
+}
+
+const char* yuyv_luma_isa_name(YuyvLumaIsa isa)
+{
+    switch(isa)
+    {
+    case YUYV_LUMA_SCALAR: return "scalar";
+    case YUYV_LUMA_SSE2:   return "sse2";
+    case YUYV_LUMA_AVX2:   return "avx2";
+    case YUYV_LUMA_NEON:   return "neon";
+    default:               return "unknown";
+    }
+}
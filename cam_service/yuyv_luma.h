@@ -0,0 +1,56 @@
+#ifndef YUYV_LUMA_H
+#define YUYV_LUMA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    #endif
+
+    // Warianty kernela wyciągania luminancji z YUYV
+    typedef enum {
+        YUYV_LUMA_SCALAR = 0,
+        YUYV_LUMA_SSE2,
+        YUYV_LUMA_AVX2,
+        YUYV_LUMA_NEON,
+        YUYV_LUMA_ISA_COUNT
+    } YuyvLumaIsa;
+
+    /**
+     * Kernel wyciągający kanał Y z klatki YUYV z opcjonalną decymacją.
+     * Przy decymacji N każdy piksel wyjścia to średnia (z zaokrągleniem) bloku NxN.
+     *
+     * @param src - bufor YUYV
+     * @param srcStride - długość wiersza YUYV w bajtach
+     * @param dst - bufor wyjściowy (width/N x height/N bajtów)
+     * @param dstStride - długość wiersza wyjścia w bajtach
+     * @param width - szerokość klatki źródłowej w pikselach (parzysta)
+     * @param height - wysokość klatki źródłowej w pikselach
+     */
+    typedef void (*YuyvLumaFn)(const unsigned char* src, size_t srcStride,
+                               unsigned char* dst, size_t dstStride,
+                               int width, int height);
+
+    /**
+     * Kernel dla konkretnego wariantu i decymacji (1, 2 lub 4)
+     * Zwraca: NULL jeśli wariant nie jest skompilowany lub CPU go nie obsługuje
+     */
+    YuyvLumaFn yuyv_luma_get(YuyvLumaIsa isa, int decimation);
+
+    /**
+     * Wybór najszybszego kernela dostępnego na tym CPU
+     *
+     * @param decimation - 1, 2 lub 4
+     * @param isaOut - (opcjonalnie) wybrany wariant
+     * @return kernel lub NULL przy nieobsługiwanej decymacji
+     */
+    YuyvLumaFn yuyv_luma_select(int decimation, YuyvLumaIsa* isaOut);
+
+    const char* yuyv_luma_isa_name(YuyvLumaIsa isa);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif // YUYV_LUMA_H